@@ -0,0 +1,147 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#include "batch.h"
+
+#include <libwnck/libwnck.h>
+#include <X11/Xutil.h>
+
+#include "screen.h"
+#include "window.h"
+#include "workspace.h"
+
+//------------------------------------------------------------------------------
+
+// The _NET_WM_STATE actions, and the source indication that says that a
+// request comes from a pager (as opposed to an application).
+#define NET_WM_STATE_REMOVE      0
+#define NET_WM_STATE_ADD         1
+#define SOURCE_INDICATION_PAGER  2
+
+//------------------------------------------------------------------------------
+
+SSBatch *
+ss_batch_new (SSScreen *screen, Display *x_display, Window x_root_window)
+{
+  SSBatch *batch;
+
+  batch = g_new (SSBatch, 1);
+  batch->screen = screen;
+  batch->x_display = x_display;
+  batch->x_root_window = x_root_window;
+  batch->x_screen_number = DefaultScreen (x_display);
+  batch->depth = 0;
+  batch->num_requests = 0;
+
+  batch->net_wm_state_atom = XInternAtom (x_display, "_NET_WM_STATE", False);
+  batch->net_wm_state_maximized_horz_atom =
+    XInternAtom (x_display, "_NET_WM_STATE_MAXIMIZED_HORZ", False);
+  batch->net_wm_state_maximized_vert_atom =
+    XInternAtom (x_display, "_NET_WM_STATE_MAXIMIZED_VERT", False);
+  batch->net_active_window_atom = XInternAtom (x_display, "_NET_ACTIVE_WINDOW", False);
+  batch->net_close_window_atom = XInternAtom (x_display, "_NET_CLOSE_WINDOW", False);
+  batch->net_wm_desktop_atom = XInternAtom (x_display, "_NET_WM_DESKTOP", False);
+  return batch;
+}
+
+//------------------------------------------------------------------------------
+
+static void
+send_client_message (SSBatch *batch, SSWindow *window, Atom message_type,
+                     long l0, long l1, long l2, long l3)
+{
+  XEvent xev;
+
+  xev.xclient.type = ClientMessage;
+  xev.xclient.serial = 0;
+  xev.xclient.send_event = True;
+  xev.xclient.display = batch->x_display;
+  xev.xclient.window = wnck_window_get_xid (window->wnck_window);
+  xev.xclient.message_type = message_type;
+  xev.xclient.format = 32;
+  xev.xclient.data.l[0] = l0;
+  xev.xclient.data.l[1] = l1;
+  xev.xclient.data.l[2] = l2;
+  xev.xclient.data.l[3] = l3;
+  xev.xclient.data.l[4] = 0;
+
+  // This only puts the request in Xlib's output buffer.
+  XSendEvent (batch->x_display, batch->x_root_window, False,
+    SubstructureRedirectMask | SubstructureNotifyMask, &xev);
+  batch->num_requests++;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_batch_begin (SSBatch *batch)
+{
+  batch->depth++;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_batch_end (SSBatch *batch)
+{
+  g_assert (batch->depth > 0);
+
+  batch->depth--;
+  if ((batch->depth > 0) || (batch->num_requests == 0)) {
+    return;
+  }
+  batch->num_requests = 0;
+
+  XFlush (batch->x_display);
+  ss_screen_hold_updates (batch->screen);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_batch_maximize (SSBatch *batch, SSWindow *window, gboolean maximize)
+{
+  send_client_message (batch, window, batch->net_wm_state_atom,
+    maximize ? NET_WM_STATE_ADD : NET_WM_STATE_REMOVE,
+    batch->net_wm_state_maximized_vert_atom,
+    batch->net_wm_state_maximized_horz_atom,
+    SOURCE_INDICATION_PAGER);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_batch_minimize (SSBatch *batch, SSWindow *window, gboolean minimize, guint32 time)
+{
+  if (minimize) {
+    // XIconifyWindow sends the ICCCM WM_CHANGE_STATE message, unflushed.
+    XIconifyWindow (batch->x_display,
+      wnck_window_get_xid (window->wnck_window), batch->x_screen_number);
+    batch->num_requests++;
+  } else {
+    // Just like libwnck, un-minimizing is done by activating the window.
+    send_client_message (batch, window, batch->net_active_window_atom,
+      SOURCE_INDICATION_PAGER, time, 0, 0);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_batch_close (SSBatch *batch, SSWindow *window, guint32 time)
+{
+  send_client_message (batch, window, batch->net_close_window_atom,
+    time, SOURCE_INDICATION_PAGER, 0, 0);
+}
+
+//------------------------------------------------------------------------------
+
+// This is only for a window manager that does not use viewports (which
+// ss_window_move_to_workspace takes care of).
+void
+ss_batch_move_to_workspace (SSBatch *batch, SSWindow *window, SSWorkspace *workspace)
+{
+  send_client_message (batch, window, batch->net_wm_desktop_atom,
+    wnck_workspace_get_number (workspace->wnck_workspace),
+    SOURCE_INDICATION_PAGER, 0, 0);
+}
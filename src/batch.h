@@ -0,0 +1,44 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#ifndef SUPERSWITCHER_BATCH_H
+#define SUPERSWITCHER_BATCH_H
+
+#include <glib.h>
+#include <X11/Xlib.h>
+
+#include "forward_declarations.h"
+
+// A batch sends the window manager requests for a whole gesture (such as
+// maximizing every window on a workspace) as EWMH client messages, rather
+// than as one libwnck call per window, and flushes them to the X server all
+// at once at the outermost ss_batch_end.  It then holds back the popup's
+// updates until the wnck signals that come back have died down, so that
+// many windows changing state costs one update, not one per window.
+struct _SSBatch {
+  SSScreen *   screen;
+  Display *    x_display;
+  Window       x_root_window;
+  int          x_screen_number;
+  int          depth;
+  int          num_requests;
+
+  Atom   net_wm_state_atom;
+  Atom   net_wm_state_maximized_horz_atom;
+  Atom   net_wm_state_maximized_vert_atom;
+  Atom   net_active_window_atom;
+  Atom   net_close_window_atom;
+  Atom   net_wm_desktop_atom;
+};
+
+SSBatch *   ss_batch_new   (SSScreen *screen, Display *x_display, Window x_root_window);
+
+void   ss_batch_begin      (SSBatch *batch);
+void   ss_batch_end        (SSBatch *batch);
+void   ss_batch_maximize   (SSBatch *batch, SSWindow *window, gboolean maximize);
+void   ss_batch_minimize   (SSBatch *batch, SSWindow *window, gboolean minimize, guint32 time);
+void   ss_batch_close      (SSBatch *batch, SSWindow *window, guint32 time);
+
+void   ss_batch_move_to_workspace   (SSBatch *batch, SSWindow *window, SSWorkspace *workspace);
+
+#endif
@@ -4,9 +4,12 @@
 #ifndef SUPERSWITCHER_FORWARD_DECLARATIONS_H
 #define SUPERSWITCHER_FORWARD_DECLARATIONS_H
 
+typedef struct _SSBatch          SSBatch;
 typedef struct _SSDragAndDrop    SSDragAndDrop;
 typedef struct _SSScreen         SSScreen;
+typedef struct _SSStacking       SSStacking;
 typedef struct _SSWindow         SSWindow;
+typedef struct _SSWindowTableEntry SSWindowTableEntry;
 typedef struct _SSWorkspace      SSWorkspace;
 typedef struct _SSXinerama       SSXinerama;
 typedef struct _SSXineramaScreen SSXineramaScreen;
@@ -29,5 +32,9 @@ typedef struct _SSThumbnailer SSThumbnailer;
 #endif
 
 extern gboolean window_manager_uses_viewports;
+extern gboolean tab_across_workspaces;
+extern gboolean switch_windows_on_release;
+extern gboolean switch_workspaces_on_release;
+extern gboolean collect_stats;
 
 #endif
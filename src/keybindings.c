@@ -0,0 +1,317 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#include "keybindings.h"
+
+#include <gdk/gdk.h>
+#include <stdlib.h>
+#include <string.h>
+#include <X11/keysym.h>
+#include <X11/XKBlib.h>
+
+//------------------------------------------------------------------------------
+
+#define CONFIG_GROUP "Keys"
+#define NUM_KEYCODES 256
+
+typedef struct _ActionName ActionName;
+struct _ActionName {
+  const char *   name;
+  SSAction       action;
+  gboolean       takes_argument;
+};
+
+static const ActionName action_names[] = {
+  { "none",                      SS_ACTION_NONE,                        FALSE },
+  { "change-workspace-by-delta", SS_ACTION_CHANGE_WORKSPACE_BY_DELTA,   TRUE  },
+  { "change-workspace",          SS_ACTION_CHANGE_WORKSPACE,            TRUE  },
+  { "change-window-by-delta",    SS_ACTION_CHANGE_WINDOW_BY_DELTA,      TRUE  },
+  { "change-window-by-mru-order", SS_ACTION_CHANGE_WINDOW_BY_MRU_ORDER, FALSE },
+  { "toggle-maximize",           SS_ACTION_TOGGLE_MAXIMIZE,             FALSE },
+  { "toggle-minimize",           SS_ACTION_TOGGLE_MINIMIZE,             FALSE },
+  { "new-workspace",             SS_ACTION_NEW_WORKSPACE,               FALSE },
+  { "delete-workspace-if-empty", SS_ACTION_DELETE_WORKSPACE_IF_EMPTY,   FALSE },
+  { "close-window",              SS_ACTION_CLOSE_WINDOW,                FALSE },
+  { "change-xinerama",           SS_ACTION_CHANGE_XINERAMA,             FALSE },
+  { "activate-next-match",       SS_ACTION_ACTIVATE_NEXT_MATCH,         FALSE },
+  { "search-backspace",          SS_ACTION_SEARCH_BACKSPACE,            FALSE },
+};
+#define NUM_ACTION_NAMES (sizeof (action_names) / sizeof (action_names[0]))
+
+// The bindings as of SuperSwitcher 0.6, before they were configurable.  The
+// F-keys are added separately, by add_default_bindings.
+static const SSKeyBinding default_bindings[] = {
+  { XK_Left,        0, SS_ACTION_CHANGE_WORKSPACE_BY_DELTA, -1 },
+  { XK_KP_Left,     0, SS_ACTION_CHANGE_WORKSPACE_BY_DELTA, -1 },
+  { XK_Right,       0, SS_ACTION_CHANGE_WORKSPACE_BY_DELTA, +1 },
+  { XK_KP_Right,    0, SS_ACTION_CHANGE_WORKSPACE_BY_DELTA, +1 },
+  { XK_Up,          0, SS_ACTION_CHANGE_WINDOW_BY_DELTA,    -1 },
+  { XK_KP_Up,       0, SS_ACTION_CHANGE_WINDOW_BY_DELTA,    -1 },
+  { XK_Down,        0, SS_ACTION_CHANGE_WINDOW_BY_DELTA,    +1 },
+  { XK_KP_Down,     0, SS_ACTION_CHANGE_WINDOW_BY_DELTA,    +1 },
+  { XK_Page_Up,     0, SS_ACTION_TOGGLE_MAXIMIZE,            0 },
+  { XK_KP_Page_Up,  0, SS_ACTION_TOGGLE_MAXIMIZE,            0 },
+  { XK_Page_Down,   0, SS_ACTION_TOGGLE_MINIMIZE,            0 },
+  { XK_KP_Page_Down, 0, SS_ACTION_TOGGLE_MINIMIZE,           0 },
+  { XK_Insert,      0, SS_ACTION_NEW_WORKSPACE,              0 },
+  { XK_KP_Insert,   0, SS_ACTION_NEW_WORKSPACE,              0 },
+  { XK_Delete,      0, SS_ACTION_DELETE_WORKSPACE_IF_EMPTY,  0 },
+  { XK_KP_Delete,   0, SS_ACTION_DELETE_WORKSPACE_IF_EMPTY,  0 },
+  { XK_Tab,         0, SS_ACTION_CHANGE_WINDOW_BY_MRU_ORDER, 0 },
+  { XK_Escape,      0, SS_ACTION_CLOSE_WINDOW,               0 },
+  { XK_Super_L,     0, SS_ACTION_CHANGE_XINERAMA,            0 },
+  { XK_Super_R,     0, SS_ACTION_CHANGE_XINERAMA,            0 },
+  { XK_Return,      0, SS_ACTION_ACTIVATE_NEXT_MATCH,        0 },
+  { XK_ISO_Enter,   0, SS_ACTION_ACTIVATE_NEXT_MATCH,        0 },
+  { XK_KP_Enter,    0, SS_ACTION_ACTIVATE_NEXT_MATCH,        0 },
+  { XK_BackSpace,   0, SS_ACTION_SEARCH_BACKSPACE,           0 },
+};
+#define NUM_DEFAULT_BINDINGS (sizeof (default_bindings) / sizeof (default_bindings[0]))
+
+//------------------------------------------------------------------------------
+
+// A map from each keysym to a GSList of its SSKeyBindings, most modifiers
+// first.
+static GHashTable *bindings_by_keysym = NULL;
+
+// The (unshifted) keysym for each keycode, looked up as needed and then kept
+// until the keyboard mapping changes.
+static Display *display = NULL;
+static KeySym keysyms_by_keycode[NUM_KEYCODES];
+static gboolean keysym_is_cached[NUM_KEYCODES];
+
+//------------------------------------------------------------------------------
+
+static int
+count_modifiers (guint modifiers)
+{
+  return ((modifiers & ShiftMask) ? 1 : 0) + ((modifiers & ControlMask) ? 1 : 0);
+}
+
+//------------------------------------------------------------------------------
+
+static gint
+compare_bindings (gconstpointer a, gconstpointer b)
+{
+  return count_modifiers (((const SSKeyBinding *) b)->modifiers) -
+         count_modifiers (((const SSKeyBinding *) a)->modifiers);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+add_binding (KeySym keysym, guint modifiers, SSAction action, int argument)
+{
+  SSKeyBinding *binding;
+  GSList *bindings;
+  GSList *i;
+
+  bindings = (GSList *) g_hash_table_lookup (bindings_by_keysym,
+    GUINT_TO_POINTER (keysym));
+
+  // A later binding, for the same keysym and modifiers, replaces an earlier.
+  for (i = bindings; i; i = i->next) {
+    binding = (SSKeyBinding *) i->data;
+    if (binding->modifiers == modifiers) {
+      binding->action = action;
+      binding->argument = argument;
+      return;
+    }
+  }
+
+  binding = g_new (SSKeyBinding, 1);
+  binding->keysym = keysym;
+  binding->modifiers = modifiers;
+  binding->action = action;
+  binding->argument = argument;
+  bindings = g_slist_insert_sorted (bindings, binding, compare_bindings);
+  g_hash_table_insert (bindings_by_keysym, GUINT_TO_POINTER (keysym), bindings);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+add_default_bindings (void)
+{
+  guint i;
+
+  for (i = 0; i < NUM_DEFAULT_BINDINGS; i++) {
+    add_binding (default_bindings[i].keysym, default_bindings[i].modifiers,
+                 default_bindings[i].action, default_bindings[i].argument);
+  }
+  for (i = 0; i < 12; i++) {
+    add_binding (XK_F1 + i, 0, SS_ACTION_CHANGE_WORKSPACE, i);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Parses a key such as "F13" or "Ctrl+Shift+Tab".
+static gboolean
+parse_key (const char *key, KeySym *out_keysym, guint *out_modifiers)
+{
+  gchar **parts;
+  int n;
+  int i;
+  gboolean ok;
+
+  parts = g_strsplit (key, "+", 0);
+  for (n = 0; parts[n] != NULL; n++) {
+  }
+
+  ok = (n > 0);
+  *out_modifiers = 0;
+  for (i = 0; ok && (i < n - 1); i++) {
+    if (g_ascii_strcasecmp (parts[i], "Shift") == 0) {
+      *out_modifiers |= ShiftMask;
+    } else if ((g_ascii_strcasecmp (parts[i], "Ctrl") == 0) ||
+               (g_ascii_strcasecmp (parts[i], "Control") == 0)) {
+      *out_modifiers |= ControlMask;
+    } else {
+      ok = FALSE;
+    }
+  }
+  if (ok) {
+    *out_keysym = XStringToKeysym (parts[n - 1]);
+    ok = (*out_keysym != NoSymbol);
+  }
+  g_strfreev (parts);
+  return ok;
+}
+
+//------------------------------------------------------------------------------
+
+// Parses an action such as "close-window" or "change-workspace 13".  Note
+// that, in the config file, workspaces are numbered from 1.
+static gboolean
+parse_action (const char *value, SSAction *out_action, int *out_argument)
+{
+  gchar *stripped;
+  gchar **parts;
+  char *end;
+  guint i;
+  gboolean ok;
+
+  stripped = g_strstrip (g_strdup (value));
+  parts = g_strsplit (stripped, " ", 2);
+  g_free (stripped);
+  ok = FALSE;
+  for (i = 0; parts[0] && (i < NUM_ACTION_NAMES); i++) {
+    if (strcmp (parts[0], action_names[i].name) != 0) {
+      continue;
+    }
+    *out_action = action_names[i].action;
+    *out_argument = 0;
+    if (action_names[i].takes_argument) {
+      if (parts[1] != NULL) {
+        *out_argument = strtol (parts[1], &end, 10);
+        ok = (end != parts[1]) && (*end == '\0');
+      }
+      if (*out_action == SS_ACTION_CHANGE_WORKSPACE) {
+        *out_argument -= 1;
+        ok = ok && (*out_argument >= 0);
+      }
+    } else {
+      ok = (parts[1] == NULL);
+    }
+    break;
+  }
+  g_strfreev (parts);
+  return ok;
+}
+
+//------------------------------------------------------------------------------
+
+static void
+load_config_file (void)
+{
+  GKeyFile *key_file;
+  gchar *filename;
+  gchar **keys;
+  gchar *value;
+  KeySym keysym;
+  guint modifiers;
+  SSAction action;
+  int argument;
+  int i;
+
+  filename = g_build_filename (g_get_user_config_dir (), "superswitcher",
+                               "keybindings", NULL);
+  key_file = g_key_file_new ();
+  if (!g_key_file_load_from_file (key_file, filename, G_KEY_FILE_NONE, NULL)) {
+    // It is fine not to have a config file.
+    g_key_file_free (key_file);
+    g_free (filename);
+    return;
+  }
+
+  keys = g_key_file_get_keys (key_file, CONFIG_GROUP, NULL, NULL);
+  for (i = 0; keys && keys[i]; i++) {
+    value = g_key_file_get_value (key_file, CONFIG_GROUP, keys[i], NULL);
+    if (!parse_key (keys[i], &keysym, &modifiers)) {
+      g_printerr ("SuperSwitcher: %s: unknown key \"%s\"\n", filename, keys[i]);
+    } else if (!parse_action (value, &action, &argument)) {
+      g_printerr ("SuperSwitcher: %s: unknown action \"%s\"\n", filename, value);
+    } else {
+      add_binding (keysym, modifiers, action, argument);
+    }
+    g_free (value);
+  }
+  g_strfreev (keys);
+  g_key_file_free (key_file);
+  g_free (filename);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+on_keys_changed (GdkKeymap *keymap, gpointer data)
+{
+  memset (keysym_is_cached, 0, sizeof (keysym_is_cached));
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_keybindings_init (Display *x_display)
+{
+  display = x_display;
+  memset (keysym_is_cached, 0, sizeof (keysym_is_cached));
+  g_signal_connect (G_OBJECT (gdk_keymap_get_default ()), "keys-changed",
+    (GCallback) on_keys_changed,
+    NULL);
+
+  bindings_by_keysym = g_hash_table_new (g_direct_hash, g_direct_equal);
+  add_default_bindings ();
+  load_config_file ();
+}
+
+//------------------------------------------------------------------------------
+
+const SSKeyBinding *
+ss_keybindings_lookup (XKeyEvent *x_key_event)
+{
+  const SSKeyBinding *binding;
+  unsigned int keycode;
+  KeySym keysym;
+  GSList *i;
+
+  keycode = x_key_event->keycode;
+  if (keycode >= NUM_KEYCODES) {
+    return NULL;
+  }
+  if (!keysym_is_cached[keycode]) {
+    keysyms_by_keycode[keycode] = XkbKeycodeToKeysym (display, keycode, 0, 0);
+    keysym_is_cached[keycode] = TRUE;
+  }
+  keysym = keysyms_by_keycode[keycode];
+
+  for (i = (GSList *) g_hash_table_lookup (bindings_by_keysym,
+         GUINT_TO_POINTER (keysym)); i; i = i->next) {
+    binding = (const SSKeyBinding *) i->data;
+    if ((x_key_event->state & binding->modifiers) == binding->modifiers) {
+      return binding;
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#ifndef SUPERSWITCHER_KEYBINDINGS_H
+#define SUPERSWITCHER_KEYBINDINGS_H
+
+#include <glib.h>
+#include <X11/Xlib.h>
+
+#include "forward_declarations.h"
+
+// What a key (pressed whilst Super is held down) does.  Unless otherwise
+// noted, Shift and Ctrl modify the action as described in the README, e.g.
+// Shift brings the active window along when changing workspace.
+typedef enum {
+  SS_ACTION_NONE,
+  SS_ACTION_CHANGE_WORKSPACE_BY_DELTA,   // The argument is the delta.
+  SS_ACTION_CHANGE_WORKSPACE,            // The argument is the 0-based number.
+  SS_ACTION_CHANGE_WINDOW_BY_DELTA,      // The argument is the delta.
+  SS_ACTION_CHANGE_WINDOW_BY_MRU_ORDER,
+  SS_ACTION_TOGGLE_MAXIMIZE,
+  SS_ACTION_TOGGLE_MINIMIZE,
+  SS_ACTION_NEW_WORKSPACE,
+  SS_ACTION_DELETE_WORKSPACE_IF_EMPTY,
+  SS_ACTION_CLOSE_WINDOW,
+  SS_ACTION_CHANGE_XINERAMA,
+  SS_ACTION_ACTIVATE_NEXT_MATCH,
+  SS_ACTION_SEARCH_BACKSPACE,
+  SS_NUM_ACTIONS
+} SSAction;
+
+typedef struct _SSKeyBinding SSKeyBinding;
+struct _SSKeyBinding {
+  KeySym    keysym;
+  // The modifiers (ShiftMask, ControlMask) that must be held for this
+  // binding to apply.  The binding with the most modifiers wins.
+  guint     modifiers;
+  SSAction  action;
+  int       argument;
+};
+
+// Sets up the default bindings, and then those in the user's config file
+// (see the README), if there is one.
+void   ss_keybindings_init   (Display *x_display);
+
+// Returns the binding for the key press, or NULL if there is none.  A key
+// bound to none has a binding (whose action is SS_ACTION_NONE), so that it
+// does nothing, rather than being typed into the search.
+const SSKeyBinding *   ss_keybindings_lookup   (XKeyEvent *x_key_event);
+
+#endif
@@ -9,7 +9,10 @@
 #include <X11/X.h>
 #include "string.h"
 
+#include "batch.h"
 #include "draganddrop.h"
+#include "keybindings.h"
+#include "stats.h"
 #include "window.h"
 #include "workspace.h"
 #include "xinerama.h"
@@ -18,31 +21,40 @@
 
 static void
 action_change_active_window_by_delta (Popup *popup, int delta, gboolean also_bring_active_window,
-  guint32 time, gboolean also_warp_pointer_if_necessary)
+  gboolean select_only, guint32 time, gboolean also_warp_pointer_if_necessary)
 {
-  GList *window_list;
-  GList *i;
+  SSWorkspace *workspace;
+  GPtrArray *windows;
   SSWindow *aw;
   SSWindow *window;
-  SSWindow *previous_window;
-  gboolean should_activate_next_window;
   int n, num_windows;
 
-  if (popup->screen->active_workspace == NULL) {
+  // This steps from the highlighted window, which is the active window
+  // unless another one has been selected (and not yet activated).
+  workspace = ss_screen_get_highlighted_workspace (popup->screen);
+  if (workspace == NULL) {
     return;
   }
 
-  window_list = popup->screen->active_workspace->windows;
-  aw = popup->screen->active_window;
-  num_windows = g_list_length (window_list);
+  windows = workspace->windows;
+  aw = ss_screen_get_highlighted_window (popup->screen);
+  num_windows = windows->len;
+  // A workspace that has been selected (and not yet activated) is stepped
+  // through from its first or last window, as if it had no active window.
+  if ((aw != NULL) && (aw->workspace != workspace)) {
+    aw = NULL;
+  }
   if (aw == NULL) {
     if (num_windows > 0) {
-      if (delta == +1) {
-        window = (SSWindow *) (g_list_first (window_list))->data;
+      n = (delta == +1) ? 0 : (num_windows - 1);
+      window = (SSWindow *) g_ptr_array_index (windows, n);
+      if (select_only) {
+        ss_screen_select_window (popup->screen, window);
+      } else if (workspace != popup->screen->active_workspace) {
+        ss_window_activate_workspace_and_window (window, time, also_warp_pointer_if_necessary);
       } else {
-        window = (SSWindow *) (g_list_last  (window_list))->data;
+        ss_window_activate_window (window, time, also_warp_pointer_if_necessary);
       }
-      ss_window_activate_window (window, time, also_warp_pointer_if_necessary);
     }
     return;
   }
@@ -51,46 +63,30 @@ action_change_active_window_by_delta (Popup *popup, int delta, gboolean also_bri
     return;
   }
 
-  if (also_bring_active_window) {
-    n = g_list_index (window_list, aw) + delta;
-    if (n == -1) {
-      n = num_windows - 1;
-    }
-    else if (n == num_windows) {
-      n = 0;
-    }
-    ss_workspace_reorder_window (popup->screen->active_workspace, aw, n);
-    gtk_widget_queue_draw (popup->window);
+  n = ss_workspace_get_window_index (workspace, aw);
+  if (n == -1) {
     return;
   }
+  n += delta;
+  if (n == -1) {
+    n = num_windows - 1;
+  }
+  else if (n == num_windows) {
+    n = 0;
+  }
 
-  should_activate_next_window = FALSE;
-
-  previous_window = (SSWindow *) (g_list_last (window_list))->data;
-  for (i = window_list; i; i = i->next) {
-    window = (SSWindow *) i->data;
-
-    if (should_activate_next_window) {
-      ss_window_activate_window (window, time, also_warp_pointer_if_necessary);
-      return;
-    }
-
-    if (window == aw) {
-      if (delta == +1) {
-        should_activate_next_window = TRUE;
-      } else if (delta == -1) {
-        ss_window_activate_window (previous_window, time, also_warp_pointer_if_necessary);
-        return;
-      } else {
-        g_assert_not_reached ();
-      }
-    }
-
-    previous_window = window;
+  if (also_bring_active_window) {
+    ss_workspace_reorder_window (workspace, aw, n);
+    gtk_widget_queue_draw (popup->window);
+    return;
   }
 
-  if (should_activate_next_window) {
-    window = (SSWindow *) (g_list_first (window_list))->data;
+  window = (SSWindow *) g_ptr_array_index (windows, n);
+  if (select_only) {
+    ss_screen_select_window (popup->screen, window);
+  } else if (workspace != popup->screen->active_workspace) {
+    ss_window_activate_workspace_and_window (window, time, also_warp_pointer_if_necessary);
+  } else {
     ss_window_activate_window (window, time, also_warp_pointer_if_necessary);
   }
 }
@@ -98,27 +94,38 @@ action_change_active_window_by_delta (Popup *popup, int delta, gboolean also_bri
 //------------------------------------------------------------------------------
 
 static void
-action_change_active_window_by_stacking_order (Popup *popup, gboolean backwards, guint32 time)
+action_change_active_window_by_mru_order (Popup *popup, gboolean backwards, gboolean select_only, guint32 time)
 {
-  ss_screen_activate_next_window_in_stacking_order (popup->screen, backwards, time);
+  ss_screen_activate_next_window_in_mru_order (popup->screen, backwards,
+    tab_across_workspaces, select_only, time);
 }
 
 //------------------------------------------------------------------------------
 
 static void
-action_change_active_workspace_by_delta (Popup *popup, int delta, gboolean also_bring_active_window, gboolean all_not_just_current_window, guint32 time)
+action_change_active_workspace_by_delta (Popup *popup, int delta, gboolean also_bring_active_window, gboolean all_not_just_current_window, gboolean select_only, guint32 time)
 {
-  ss_screen_change_active_workspace_by_delta (popup->screen, delta,
-    also_bring_active_window, all_not_just_current_window, time);
+  if (select_only) {
+    ss_screen_select_workspace_by_delta (popup->screen, delta,
+      also_bring_active_window, all_not_just_current_window);
+  } else {
+    ss_screen_change_active_workspace_by_delta (popup->screen, delta,
+      also_bring_active_window, all_not_just_current_window, time);
+  }
 }
 
 //------------------------------------------------------------------------------
 
 static void
-action_change_active_workspace (Popup *popup, int n, gboolean also_bring_active_window, gboolean all_not_just_current_window, guint32 time)
+action_change_active_workspace (Popup *popup, int n, gboolean also_bring_active_window, gboolean all_not_just_current_window, gboolean select_only, guint32 time)
 {
-  ss_screen_change_active_workspace (popup->screen, n,
-    also_bring_active_window, all_not_just_current_window, time);
+  if (select_only) {
+    ss_screen_select_workspace (popup->screen, n,
+      also_bring_active_window, all_not_just_current_window);
+  } else {
+    ss_screen_change_active_workspace (popup->screen, n,
+      also_bring_active_window, all_not_just_current_window, time);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -154,21 +161,23 @@ action_delete_workspace_if_empty (Popup *popup, gboolean all_not_just_current_wo
   // where we move a whole bunch of windows one or more workspaces to the
   // left before changing the count, to give the *appearance* of deleting
   // a specific workspace.
-  GList *workspaces;
+  GPtrArray *workspaces;
 
   SSWorkspace *workspace;
   SSWindow *window;
+  guint w;
+  guint k;
   GList *i;
   GList *j;
 
   int num_workspaces_deleted;
   gboolean active_workspace_has_been_seen;
 
-  GList *wnck_windows_to_move;
-  GList *wnck_workspaces_to_move_to;
+  GList *windows_to_move;
+  GList *workspaces_to_move_to;
 
-  GList *wwtmt_as_glist;
-  WnckWorkspace *wnck_workspace_to_move_to;
+  guint wtmt_index;
+  SSWorkspace *workspace_to_move_to;
 
   WnckWorkspace *wnck_workspace_to_activate;
 
@@ -177,15 +186,15 @@ action_delete_workspace_if_empty (Popup *popup, gboolean all_not_just_current_wo
   workspaces = popup->screen->workspaces;
 
   num_workspaces_deleted = 0;
-  wnck_windows_to_move = NULL;
-  wnck_workspaces_to_move_to = NULL;
+  windows_to_move = NULL;
+  workspaces_to_move_to = NULL;
 
   wnck_workspace_to_activate = NULL;
 
 
   // We proceed in two stages.  First, we make two parallel lists of
-  // the wnck_windows we want to move (and the wnck_workspaces we will
-  // move them to).  Once we have constructed these lists in their
+  // the windows we want to move (and the workspaces we will move them
+  // to).  Once we have constructed these lists in their
   // entirety, we will do the actual moving.
   // Doing this in two stages, rather than moving windows as we find them,
   // avoids (indirectly) changing the underlying data structures whilst
@@ -193,27 +202,31 @@ action_delete_workspace_if_empty (Popup *popup, gboolean all_not_just_current_wo
   if (all_not_just_current_workspace) {
     // Delete all empty workspaces
 
-    wwtmt_as_glist = workspaces;
-    wnck_workspace_to_move_to = ((SSWorkspace *) wwtmt_as_glist->data)->wnck_workspace;
+    wtmt_index = 0;
+    workspace_to_move_to = (SSWorkspace *) g_ptr_array_index (workspaces, wtmt_index);
 
-    for (i = workspaces; i; i = i->next) {
-      workspace = (SSWorkspace *) i->data;
+    for (w = 0; w < workspaces->len; w++) {
+      workspace = (SSWorkspace *) g_ptr_array_index (workspaces, w);
 
       if (workspace == popup->screen->active_workspace) {
-        wnck_workspace_to_activate = wnck_workspace_to_move_to;
+        wnck_workspace_to_activate = workspace_to_move_to->wnck_workspace;
       }
 
-      if (g_list_length (workspace->windows) > 0) {
-        for (j = workspace->windows; j; j = j->next) {
-          window = (SSWindow *) j->data;
-          wnck_windows_to_move = g_list_append
-            (wnck_windows_to_move, window->wnck_window);
-          wnck_workspaces_to_move_to = g_list_append
-            (wnck_workspaces_to_move_to, wnck_workspace_to_move_to);
+      if (workspace->windows->len > 0) {
+        for (k = 0; k < workspace->windows->len; k++) {
+          window = (SSWindow *) g_ptr_array_index (workspace->windows, k);
+          windows_to_move = g_list_append (windows_to_move, window);
+          workspaces_to_move_to = g_list_append
+            (workspaces_to_move_to, workspace_to_move_to);
         }
 
-        wwtmt_as_glist = wwtmt_as_glist->next;
-        wnck_workspace_to_move_to = ((SSWorkspace *) wwtmt_as_glist->data)->wnck_workspace;
+        // If every workspace is non-empty, then there is nothing left to
+        // move to (and nothing left to move).
+        wtmt_index++;
+        if (wtmt_index < workspaces->len) {
+          workspace_to_move_to = (SSWorkspace *) g_ptr_array_index
+            (workspaces, wtmt_index);
+        }
       } else {
         num_workspaces_deleted++;
       }
@@ -224,26 +237,25 @@ action_delete_workspace_if_empty (Popup *popup, gboolean all_not_just_current_wo
     // Delete only the active workspace, and only if it is empty.
 
     if (popup->screen->active_workspace != NULL &&
-        g_list_length (popup->screen->active_workspace->windows) == 0) {
+        popup->screen->active_workspace->windows->len == 0) {
       active_workspace_has_been_seen = FALSE;
-      wnck_workspace_to_move_to = NULL;
-      for (i = workspaces; i; i = i->next) {
-        workspace = (SSWorkspace *) i->data;
+      workspace_to_move_to = NULL;
+      for (w = 0; w < workspaces->len; w++) {
+        workspace = (SSWorkspace *) g_ptr_array_index (workspaces, w);
 
         if (workspace == popup->screen->active_workspace) {
           active_workspace_has_been_seen = TRUE;
         }
         else if (active_workspace_has_been_seen) {
-          for (j = workspace->windows; j; j = j->next) {
-            window = (SSWindow *) j->data;
-            wnck_windows_to_move = g_list_append
-              (wnck_windows_to_move, window->wnck_window);
-            wnck_workspaces_to_move_to = g_list_append
-              (wnck_workspaces_to_move_to, wnck_workspace_to_move_to);
+          for (k = 0; k < workspace->windows->len; k++) {
+            window = (SSWindow *) g_ptr_array_index (workspace->windows, k);
+            windows_to_move = g_list_append (windows_to_move, window);
+            workspaces_to_move_to = g_list_append
+              (workspaces_to_move_to, workspace_to_move_to);
           }
         }
 
-        wnck_workspace_to_move_to = workspace->wnck_workspace;
+        workspace_to_move_to = workspace;
       }
       num_workspaces_deleted++;
     }
@@ -252,13 +264,15 @@ action_delete_workspace_if_empty (Popup *popup, gboolean all_not_just_current_wo
   // TODO - fix the moves / activations when window_manager_uses_viewports
 
   // Second stage - do the actual moves.
-  // 2a) move the windows.
-  for (i = wnck_windows_to_move, j = wnck_workspaces_to_move_to; i; i = i->next, j = j->next) {
-    wnck_window_move_to_workspace ((WnckWindow *) i->data,
-      (WnckWorkspace *) j->data);
+  // 2a) move the windows, all in one go.
+  ss_screen_begin_bulk_move (popup->screen);
+  for (i = windows_to_move, j = workspaces_to_move_to; i; i = i->next, j = j->next) {
+    ss_screen_bulk_move_window (popup->screen, (SSWindow *) i->data,
+      (SSWorkspace *) j->data);
   }
-  g_list_free (wnck_windows_to_move);
-  g_list_free (wnck_workspaces_to_move_to);
+  ss_screen_end_bulk_move (popup->screen);
+  g_list_free (windows_to_move);
+  g_list_free (workspaces_to_move_to);
 
   // 2b) maintain what appears to be the active workspace, if we're
   // deleting workspaces in bulk.
@@ -283,7 +297,7 @@ action_close_active_window (Popup *popup, gboolean all_windows_in_workspace, gui
 {
   SSWorkspace *workspace;
   SSWindow *window;
-  GList *i;
+  guint i;
 
   if (all_windows_in_workspace) {
     workspace = popup->screen->active_workspace;
@@ -291,13 +305,15 @@ action_close_active_window (Popup *popup, gboolean all_windows_in_workspace, gui
       return;
     }
 
-    for (i = workspace->windows; i; i = i->next) {
-      window = (SSWindow *) i->data;
-      wnck_window_close (window->wnck_window, time);
+    ss_batch_begin (popup->screen->batch);
+    for (i = 0; i < workspace->windows->len; i++) {
+      window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
+      ss_batch_close (popup->screen->batch, window, time);
     }
+    ss_batch_end (popup->screen->batch);
 
   } else {
-    window = popup->screen->active_window;
+    window = ss_screen_get_highlighted_window (popup->screen);
     if (window == NULL) {
       return;
     }
@@ -314,7 +330,7 @@ action_window_toggle_maximize (Popup *popup, gboolean all_windows_in_workspace,
   SSWorkspace *workspace;
   SSWindow *window;
   gboolean all_windows_are_maximized;
-  GList *i;
+  guint i;
 
   if (all_windows_in_workspace) {
     workspace = popup->screen->active_workspace;
@@ -323,28 +339,23 @@ action_window_toggle_maximize (Popup *popup, gboolean all_windows_in_workspace,
     }
 
     all_windows_are_maximized = TRUE;
-    for (i = workspace->windows; i; i = i->next) {
-      window = (SSWindow *) i->data;
+    for (i = 0; i < workspace->windows->len; i++) {
+      window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
       if (! wnck_window_is_maximized (window->wnck_window)) {
         all_windows_are_maximized = FALSE;
         break;
       }
     }
 
-    if (all_windows_are_maximized) {
-      for (i = workspace->windows; i; i = i->next) {
-        window = (SSWindow *) i->data;
-        wnck_window_unmaximize (window->wnck_window);
-      }
-    } else {
-      for (i = workspace->windows; i; i = i->next) {
-        window = (SSWindow *) i->data;
-        wnck_window_maximize (window->wnck_window);
-      }
+    ss_batch_begin (popup->screen->batch);
+    for (i = 0; i < workspace->windows->len; i++) {
+      window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
+      ss_batch_maximize (popup->screen->batch, window, !all_windows_are_maximized);
     }
+    ss_batch_end (popup->screen->batch);
 
   } else {
-    window = popup->screen->active_window;
+    window = ss_screen_get_highlighted_window (popup->screen);
     if (window == NULL) {
       return;
     }
@@ -365,7 +376,7 @@ action_window_toggle_minimize (Popup *popup, gboolean all_windows_in_workspace,
   SSWorkspace *workspace;
   SSWindow *window;
   gboolean all_windows_are_minimized;
-  GList *i;
+  guint i;
 
   if (all_windows_in_workspace) {
     workspace = popup->screen->active_workspace;
@@ -374,28 +385,23 @@ action_window_toggle_minimize (Popup *popup, gboolean all_windows_in_workspace,
     }
 
     all_windows_are_minimized = TRUE;
-    for (i = workspace->windows; i; i = i->next) {
-      window = (SSWindow *) i->data;
+    for (i = 0; i < workspace->windows->len; i++) {
+      window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
       if (! wnck_window_is_minimized (window->wnck_window)) {
         all_windows_are_minimized = FALSE;
         break;
       }
     }
 
-    if (all_windows_are_minimized) {
-      for (i = workspace->windows; i; i = i->next) {
-        window = (SSWindow *) i->data;
-        wnck_window_unminimize (window->wnck_window, time);
-      }
-    } else {
-      for (i = workspace->windows; i; i = i->next) {
-        window = (SSWindow *) i->data;
-        wnck_window_minimize (window->wnck_window);
-      }
+    ss_batch_begin (popup->screen->batch);
+    for (i = 0; i < workspace->windows->len; i++) {
+      window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
+      ss_batch_minimize (popup->screen->batch, window, !all_windows_are_minimized, time);
     }
+    ss_batch_end (popup->screen->batch);
 
   } else {
-    window = popup->screen->active_window;
+    window = ss_screen_get_highlighted_window (popup->screen);
     if (window == NULL) {
       return;
     }
@@ -421,7 +427,8 @@ action_activate_next_window (Popup *popup, gboolean backwards, guint32 time)
 static void
 action_change_xinerama (Popup *popup, guint32 time)
 {
-  ss_xinerama_move_to_next_screen (popup->screen->xinerama, popup->screen->active_window);
+  ss_xinerama_move_to_next_screen (popup->screen->xinerama,
+    ss_screen_get_highlighted_window (popup->screen));
 }
 
 //------------------------------------------------------------------------------
@@ -449,10 +456,8 @@ on_active_workspace_changed (SSScreen *screen, gpointer data)
 static void
 on_window_opened (SSScreen *screen, SSWindow *window, gpointer data)
 {
-  if (window == NULL) {
-    return;
-  }
-  gtk_widget_show_all (window->widget);
+  // No-op.  The window's widget is shown when it is first put into its
+  // workspace's column, by ss_workspace_update_window_widgets.
 }
 
 //------------------------------------------------------------------------------
@@ -468,8 +473,6 @@ on_window_closed (SSScreen *screen, SSWindow *window, gpointer data)
 static void
 on_workspace_created (SSScreen *screen, SSWorkspace *workspace, gpointer data)
 {
-  GList *i;
-  SSWindow *window;
   Popup *popup;
   popup = (Popup *) data;
 
@@ -478,14 +481,7 @@ on_workspace_created (SSScreen *screen, SSWorkspace *workspace, gpointer data)
   if (popup->owc_complete_action_new_workspace) {
     if (popup->owc_also_bring_active_window) {
       if (popup->owc_all_not_just_current_window) {
-        if (screen->active_workspace != NULL) {
-          for (i = screen->active_workspace->windows; i; i = i->next) {
-            window = (SSWindow *) i->data;
-            wnck_window_move_to_workspace (
-              window->wnck_window,
-              workspace->wnck_workspace);
-          }
-        }  // end if (screen->active_workspace != NULL)
+        ss_screen_move_windows (screen, screen->active_workspace, workspace);
       } else {  // else if (popup->owc_all_not_just_current_window)
         if (screen->active_window != NULL) {
           wnck_window_move_to_workspace (
@@ -526,12 +522,12 @@ on_scroll_event (GtkWidget *widget, GdkEventScroll *event, gpointer data)
   switch (event->direction) {
   case GDK_SCROLL_UP:
   case GDK_SCROLL_LEFT:
-    action_change_active_window_by_delta (popup, -1, shifted, event->time, FALSE);
+    action_change_active_window_by_delta (popup, -1, shifted, FALSE, event->time, FALSE);
     break;
 
   case GDK_SCROLL_DOWN:
   case GDK_SCROLL_RIGHT:
-    action_change_active_window_by_delta (popup, +1, shifted, event->time, FALSE);
+    action_change_active_window_by_delta (popup, +1, shifted, FALSE, event->time, FALSE);
     break;
 
   default:
@@ -556,6 +552,20 @@ on_leave_notify_event (GtkWidget *widget, GdkEvent *event, gpointer data)
 
 //------------------------------------------------------------------------------
 
+static gboolean
+on_first_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
+{
+  Popup *popup;
+  popup = (Popup *) data;
+  if (popup->is_awaiting_first_expose) {
+    popup->is_awaiting_first_expose = FALSE;
+    ss_stats_mark (SS_STATS_KEY_PRESS_TO_FIRST_EXPOSE);
+  }
+  return FALSE;
+}
+
+//------------------------------------------------------------------------------
+
 static gboolean
 on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
 {
@@ -604,7 +614,7 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
       newx1 = +3 + a->x + a->width;
       a = &(dnd->drag_workspace->window_container->allocation);
       y = a->y;
-      n = g_list_length (dnd->drag_workspace->windows);
+      n = dnd->drag_workspace->windows->len;
       if (n != 0) {
         if (dnd->new_window_index != -1) {
           y += (a->height * dnd->new_window_index) / n;
@@ -804,15 +814,13 @@ update_search (Popup *popup)
 //------------------------------------------------------------------------------
 
 Popup *
-popup_create (SSScreen *screen)
+popup_new (SSScreen *screen)
 {
   Popup *popup;
   GtkWidget *frame;
   GtkWidget *vbox;
   GtkWidget *align;
 
-  ss_screen_update_search (screen, "");
-
   popup = g_new (Popup, 1);
   popup->screen = screen;
 
@@ -824,6 +832,8 @@ popup_create (SSScreen *screen)
   popup->owc_all_not_just_current_window = FALSE;
   popup->owc_time = -1;
 
+  popup->is_awaiting_first_expose = FALSE;
+
   popup->signal_id_active_window_changed =
     g_signal_connect (G_OBJECT (screen), "active-window-changed",
     (GCallback) on_active_window_changed,
@@ -861,6 +871,11 @@ popup_create (SSScreen *screen)
   g_signal_connect_after (G_OBJECT (popup->window), "expose-event",
     (GCallback) on_expose_event,
     popup);
+  if (collect_stats) {
+    g_signal_connect_after (G_OBJECT (popup->window), "expose-event",
+      (GCallback) on_first_expose_event,
+      popup);
+  }
 
   vbox = gtk_vbox_new (FALSE, 2);
 
@@ -877,7 +892,58 @@ popup_create (SSScreen *screen)
   gtk_box_pack_start (GTK_BOX (vbox), gtk_hseparator_new (), FALSE, FALSE, 0);
   button_bar_create (popup, vbox);
 
-  gtk_widget_show_all (popup->window);
+  // Show everything but the window itself, which is popup_show's job.
+  gtk_widget_show_all (frame);
+  return popup;
+}
+
+//------------------------------------------------------------------------------
+
+void
+popup_show (Popup *popup)
+{
+  // This brings the widgets up to date before the first frame is drawn.
+  ss_screen_set_visible (popup->screen, TRUE);
+  ss_screen_update_search (popup->screen, "");
+  ss_screen_freeze_mru (popup->screen);
+  popup->is_awaiting_first_expose = TRUE;
+  gtk_widget_show (popup->window);
+  ss_stats_mark (SS_STATS_KEY_PRESS_TO_POPUP_SHOWN);
+}
+
+//------------------------------------------------------------------------------
+
+void
+popup_hide (Popup *popup)
+{
+  GtkWidget *search_widget;
+
+  ss_screen_thaw_mru (popup->screen);
+  ss_screen_set_visible (popup->screen, FALSE);
+  gtk_widget_hide (popup->window);
+
+  // Forget any search, so that the next popup_show starts afresh.
+  if (popup->search_text_label != NULL) {
+    search_widget = GTK_BIN (popup->search_container)->child;
+    gtk_widget_destroy (search_widget);
+    popup->search_text_label = NULL;
+    popup->search_num_matches_label = NULL;
+  }
+
+  popup->owc_complete_action_new_workspace = FALSE;
+  popup->owc_also_bring_active_window = FALSE;
+  popup->owc_all_not_just_current_window = FALSE;
+  popup->owc_time = -1;
+}
+
+//------------------------------------------------------------------------------
+
+Popup *
+popup_create (SSScreen *screen)
+{
+  Popup *popup;
+  popup = popup_new (screen);
+  popup_show (popup);
   return popup;
 }
 
@@ -886,7 +952,7 @@ popup_create (SSScreen *screen)
 void
 popup_free (Popup *popup)
 {
-  ss_screen_update_wnck_windows_in_stacking_order (popup->screen);
+  popup_hide (popup);
   gtk_container_remove (GTK_CONTAINER (popup->screen_container),
     popup->screen->widget);
 
@@ -913,7 +979,7 @@ void
 popup_on_key_press (Popup *popup, Display *x_display, XKeyEvent *x_key_event)
 {
   char key_string[4];
-  KeySym keysym;
+  const SSKeyBinding *binding;
   gboolean shifted;
   gboolean ctrled;
   guint32 time;
@@ -921,92 +987,75 @@ popup_on_key_press (Popup *popup, Display *x_display, XKeyEvent *x_key_event)
   const gchar *old_search_text;
   gchar *new_search_text;
 
-  key_string[0] = '\0';
-  key_string[1] = '\0';
-  key_string[2] = '\0';
-  key_string[3] = '\0';
-  XLookupString (x_key_event, key_string, 3, NULL, NULL);
-
-  keysym = XKeycodeToKeysym (x_display, x_key_event->keycode, 0);
   shifted = ((x_key_event->state & ShiftMask) == ShiftMask);
   ctrled  = ((x_key_event->state & ControlMask) == ControlMask);
   time = x_key_event->time;
 
-  if ((keysym == XK_Left) || (keysym == XK_KP_Left)) {
-    action_change_active_workspace_by_delta (popup, -1, shifted, ctrled, time);
-  }
-  else if ((keysym == XK_Right) || (keysym == XK_KP_Right)) {
-    action_change_active_workspace_by_delta (popup, +1, shifted, ctrled, time);
-  }
-  else if ((keysym == XK_Up) || (keysym == XK_KP_Up)) {
-    action_change_active_window_by_delta (popup, -1, shifted, time, TRUE);
-  }
-  else if ((keysym == XK_Down) || (keysym == XK_KP_Down)) {
-    action_change_active_window_by_delta (popup, +1, shifted, time, TRUE);
+  binding = ss_keybindings_lookup (x_key_event);
+  if (binding == NULL) {
+    // Any other key is (part of) a search.
+    key_string[0] = '\0';
+    key_string[1] = '\0';
+    key_string[2] = '\0';
+    key_string[3] = '\0';
+    XLookupString (x_key_event, key_string, 3, NULL, NULL);
+    if (key_string[0] != '\0') {
+      if (popup->search_text_label == NULL) {
+        search_widget_create (popup);
+        gtk_widget_queue_draw (popup->window);
+      }
+      old_search_text = gtk_label_get_text (GTK_LABEL (popup->search_text_label));
+      new_search_text = g_strdup_printf ("%s%s", old_search_text, key_string);
+      gtk_label_set_text (GTK_LABEL (popup->search_text_label), new_search_text);
+      g_free (new_search_text);
+
+      update_search (popup);
+    }
+    return;
   }
-  else if ((keysym == XK_Page_Up) || (keysym == XK_KP_Page_Up)) {
+
+  switch (binding->action) {
+  case SS_ACTION_NONE:
+    break;
+  case SS_ACTION_CHANGE_WORKSPACE_BY_DELTA:
+    action_change_active_workspace_by_delta (popup, binding->argument, shifted, ctrled,
+      TRUE, time);
+    break;
+  case SS_ACTION_CHANGE_WORKSPACE:
+    action_change_active_workspace (popup, binding->argument, shifted, ctrled,
+      TRUE, time);
+    break;
+  case SS_ACTION_CHANGE_WINDOW_BY_DELTA:
+    action_change_active_window_by_delta (popup, binding->argument, shifted,
+      TRUE, time, TRUE);
+    break;
+  case SS_ACTION_CHANGE_WINDOW_BY_MRU_ORDER:
+    action_change_active_window_by_mru_order (popup, shifted, TRUE, time);
+    break;
+  case SS_ACTION_TOGGLE_MAXIMIZE:
     action_window_toggle_maximize (popup, ctrled, time);
-  }
-  else if ((keysym == XK_Page_Down) || (keysym == XK_KP_Page_Down)) {
+    break;
+  case SS_ACTION_TOGGLE_MINIMIZE:
     action_window_toggle_minimize (popup, ctrled, time);
-  }
-  else if ((keysym == XK_Insert) || (keysym == XK_KP_Insert)) {
+    break;
+  case SS_ACTION_NEW_WORKSPACE:
     action_new_workspace (popup, shifted, ctrled, time);
-  }
-  else if ((keysym == XK_Delete) || (keysym == XK_KP_Delete)) {
+    break;
+  case SS_ACTION_DELETE_WORKSPACE_IF_EMPTY:
     // I forget whether it should be Super-Shift-Delete or Super-
     // Ctrl-Delete according to the system, so let's allow both.
     action_delete_workspace_if_empty (popup, shifted | ctrled, time);
-  }
-  else if (keysym == XK_Tab) {
-    action_change_active_window_by_stacking_order (popup, shifted, time);
-  }
-  else if (keysym == XK_Escape) {
+    break;
+  case SS_ACTION_CLOSE_WINDOW:
     action_close_active_window (popup, ctrled, time);
-  }
-  else if (keysym == XK_F1) {
-    action_change_active_workspace (popup,  0, shifted, ctrled, time);
-  }
-  else if (keysym == XK_F2) {
-    action_change_active_workspace (popup,  1, shifted, ctrled, time);
-  }
-  else if (keysym == XK_F3) {
-    action_change_active_workspace (popup,  2, shifted, ctrled, time);
-  }
-  else if (keysym == XK_F4) {
-    action_change_active_workspace (popup,  3, shifted, ctrled, time);
-  }
-  else if (keysym == XK_F5) {
-    action_change_active_workspace (popup,  4, shifted, ctrled, time);
-  }
-  else if (keysym == XK_F6) {
-    action_change_active_workspace (popup,  5, shifted, ctrled, time);
-  }
-  else if (keysym == XK_F7) {
-    action_change_active_workspace (popup,  6, shifted, ctrled, time);
-  }
-  else if (keysym == XK_F8) {
-    action_change_active_workspace (popup,  7, shifted, ctrled, time);
-  }
-  else if (keysym == XK_F9) {
-    action_change_active_workspace (popup,  8, shifted, ctrled, time);
-  }
-  else if (keysym == XK_F10) {
-    action_change_active_workspace (popup,  9, shifted, ctrled, time);
-  }
-  else if (keysym == XK_F11) {
-    action_change_active_workspace (popup, 10, shifted, ctrled, time);
-  }
-  else if (keysym == XK_F12) {
-    action_change_active_workspace (popup, 11, shifted, ctrled, time);
-  }
-  else if ((keysym == XK_Super_L) || (keysym == XK_Super_R)) {
+    break;
+  case SS_ACTION_CHANGE_XINERAMA:
     action_change_xinerama (popup, time);
-  }
-  else if ((keysym == XK_Return) || (keysym == XK_ISO_Enter) || (keysym == XK_KP_Enter)) {
+    break;
+  case SS_ACTION_ACTIVATE_NEXT_MATCH:
     action_activate_next_window (popup, shifted, time);
-  }
-  else if (keysym == XK_BackSpace) {
+    break;
+  case SS_ACTION_SEARCH_BACKSPACE:
     if (popup->search_text_label != NULL) {
       old_search_text = gtk_label_get_text (GTK_LABEL (popup->search_text_label));
       n = strlen (old_search_text);
@@ -1018,19 +1067,51 @@ popup_on_key_press (Popup *popup, Display *x_display, XKeyEvent *x_key_event)
 
       update_search (popup);
     }
+    break;
+  default:
+    break;
   }
-  else {
-    if (key_string[0] != '\0') {
-      if (popup->search_text_label == NULL) {
-        search_widget_create (popup);
-        gtk_widget_queue_draw (popup->window);
-      }
-      old_search_text = gtk_label_get_text (GTK_LABEL (popup->search_text_label));
-      new_search_text = g_strdup_printf ("%s%s", old_search_text, key_string);
-      gtk_label_set_text (GTK_LABEL (popup->search_text_label), new_search_text);
-      g_free (new_search_text);
+}
 
-      update_search (popup);
-    }
+//------------------------------------------------------------------------------
+
+gboolean
+popup_on_key_press_while_hidden (SSScreen *screen, Display *x_display, XKeyEvent *x_key_event)
+{
+  const SSKeyBinding *binding;
+  gboolean shifted;
+  gboolean ctrled;
+
+  shifted = ((x_key_event->state & ShiftMask) == ShiftMask);
+  ctrled  = ((x_key_event->state & ControlMask) == ControlMask);
+
+  // Only those actions that need nothing but the SSScreen are done here.
+  // Anything else (e.g. searching, or re-ordering windows) wants the popup.
+  binding = ss_keybindings_lookup (x_key_event);
+  if (binding == NULL) {
+    return FALSE;
+  }
+  switch (binding->action) {
+  case SS_ACTION_NONE:
+    // There is nothing to do, so there is no need to bring up the popup.
+    break;
+  case SS_ACTION_CHANGE_WORKSPACE_BY_DELTA:
+    ss_screen_select_workspace_by_delta (screen, binding->argument,
+      shifted, ctrled);
+    break;
+  case SS_ACTION_CHANGE_WORKSPACE:
+    ss_screen_select_workspace (screen, binding->argument, shifted, ctrled);
+    break;
+  case SS_ACTION_CHANGE_WINDOW_BY_MRU_ORDER:
+    ss_screen_activate_next_window_in_mru_order (screen, shifted,
+      tab_across_workspaces, TRUE, x_key_event->time);
+    break;
+  case SS_ACTION_CHANGE_XINERAMA:
+    ss_xinerama_move_to_next_screen (screen->xinerama,
+      ss_screen_get_highlighted_window (screen));
+    break;
+  default:
+    return FALSE;
   }
+  return TRUE;
 }
@@ -27,6 +27,8 @@ struct _Popup
   gulong   signal_id_workspace_created;
   gulong   signal_id_workspace_destroyed;
 
+  gboolean   is_awaiting_first_expose;
+
   // on_workspace_created hack
   gboolean   owc_complete_action_new_workspace;
   gboolean   owc_also_bring_active_window;
@@ -34,9 +36,23 @@ struct _Popup
   guint32    owc_time;
 };
 
+// popup_create is popup_new followed by popup_show, and popup_free is
+// popup_hide followed by freeing.  A persistent popup is built once by
+// popup_new, and then just shown and hidden.
+Popup *   popup_new      (SSScreen *screen);
 Popup *   popup_create   (SSScreen *screen);
 void      popup_free     (Popup *popup_window);
+void      popup_show     (Popup *popup_window);
+void      popup_hide     (Popup *popup_window);
 
+// A workspace or window navigation key (including each of its autorepeats)
+// only moves the selection, which filter_func activates once, when the key
+// (or, with --switch-*-on-release, Super) is released.  See
+// ss_screen_commit_selection.
 void   popup_on_key_press   (Popup *popup_window, Display *x_display, XKeyEvent *x_key_event);
 
+// Handles a key press before any popup has been shown, returning FALSE if
+// that key's action needs the popup (in which case nothing was done).
+gboolean   popup_on_key_press_while_hidden   (SSScreen *screen, Display *x_display, XKeyEvent *x_key_event);
+
 #endif
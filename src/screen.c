@@ -10,6 +10,7 @@
 #include <gconf/gconf-client.h>
 #endif
 
+#include "batch.h"
 #include "draganddrop.h"
 #include "window.h"
 #include "workspace.h"
@@ -41,32 +42,31 @@ static guint gconf_focus_mode_notify_id = 0;
 //------------------------------------------------------------------------------
 
 static SSWindow *
-get_ss_window_from_wnck_window (SSScreen *screen, WnckWindow *wnck_window)
+lookup_ss_window (SSScreen *screen, WnckWindow *wnck_window)
 {
-  gulong xid;
-  SSWorkspace *workspace;
-  SSWindow *window;
-  GList *i;
-  GList *j;
-
   if (wnck_window == NULL) {
     return NULL;
   }
+  // X IDs are at most 29 bits wide, so they fit in a pointer-sized key.
+  return (SSWindow *) g_hash_table_lookup (screen->windows_by_xid,
+    GUINT_TO_POINTER (wnck_window_get_xid (wnck_window)));
+}
 
-  xid = wnck_window_get_xid (wnck_window);
+//------------------------------------------------------------------------------
 
-  // Walk through the list of list of windows, matching by X ID.
-  for (i = screen->workspaces; i; i = i->next) {
-    workspace = (SSWorkspace *) i->data;
-    for (j = workspace->windows; j; j = j->next) {
-      window = (SSWindow *) j->data;
-      if (xid == wnck_window_get_xid (window->wnck_window)) {
-        return window;
-      }
-    }
-  }
+static SSWindow *
+get_ss_window_from_wnck_window (SSScreen *screen, WnckWindow *wnck_window)
+{
+  SSWindow *window;
+
+  window = lookup_ss_window (screen, wnck_window);
 
-  return NULL;
+  // Windows that currently belong to no workspace (e.g. those that have been
+  // pinned) are still indexed, but they are not shown, so we ignore them.
+  if ((window == NULL) || (window->workspace == NULL)) {
+    return NULL;
+  }
+  return window;
 }
 
 //------------------------------------------------------------------------------
@@ -74,48 +74,127 @@ get_ss_window_from_wnck_window (SSScreen *screen, WnckWindow *wnck_window)
 static SSWorkspace *
 get_ss_workspace_from_wnck_workspace (SSScreen *screen, WnckWorkspace *wnck_workspace, int viewport)
 {
-  SSWorkspace *workspace;
-  GList *i;
-
   if (wnck_workspace == NULL) {
     return NULL;
   }
 
   if (window_manager_uses_viewports) {
-    return (SSWorkspace *) g_list_nth_data (screen->workspaces, viewport);
+    return ss_screen_get_nth_workspace (screen, viewport);
   }
 
-  for (i = screen->workspaces; i; i = i->next) {
-    workspace = (SSWorkspace *) i->data;
-    if (wnck_workspace == workspace->wnck_workspace) {
-      return workspace;
+  return (SSWorkspace *) g_hash_table_lookup (
+    screen->workspaces_by_wnck_workspace, wnck_workspace);
+}
+
+//------------------------------------------------------------------------------
+
+#ifdef ENABLE_DEBUG
+static void
+check_indexed_window (gpointer key, gpointer value, gpointer data)
+{
+  SSWindow *window;
+  window = (SSWindow *) value;
+  g_assert (GPOINTER_TO_UINT (key) == wnck_window_get_xid (window->wnck_window));
+  if (window->workspace != NULL) {
+    g_assert (g_ptr_array_index (window->workspace->windows,
+      ss_workspace_get_window_index (window->workspace, window)) == window);
+    (*((int *) data))++;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_check_consistency (SSScreen *screen)
+{
+  SSWorkspace *workspace;
+  SSWindow *window;
+  SSWindowTableEntry *entry;
+  guint i;
+  guint j;
+  int num_listed_windows;
+  int num_indexed_windows;
+
+  // Every workspace must be at its own index, and (without viewports) be
+  // mapped from its WnckWorkspace.
+  for (i = 0; i < screen->workspaces->len; i++) {
+    workspace = (SSWorkspace *) g_ptr_array_index (screen->workspaces, i);
+    g_assert (ss_screen_get_nth_workspace (screen, i) == workspace);
+    if (!window_manager_uses_viewports) {
+      g_assert (get_ss_workspace_from_wnck_workspace (
+        screen, workspace->wnck_workspace, 0) == workspace);
     }
   }
 
-  return NULL;
+  // Every window in a workspace's list must be indexed under its X ID...
+  num_listed_windows = 0;
+  for (i = 0; i < screen->workspaces->len; i++) {
+    workspace = (SSWorkspace *) g_ptr_array_index (screen->workspaces, i);
+    for (j = 0; j < workspace->windows->len; j++) {
+      window = (SSWindow *) g_ptr_array_index (workspace->windows, j);
+      g_assert (window->workspace == workspace);
+      g_assert (lookup_ss_window (screen, window->wnck_window) == window);
+      num_listed_windows++;
+
+      // ...and be in its row of the window table.
+      entry = &g_array_index (screen->window_table, SSWindowTableEntry,
+        window->table_index);
+      g_assert (window->table_index == workspace->first_table_index + (int) j);
+      g_assert (entry->window == window);
+      g_assert (entry->sensitive == (window->sensitive ? 1 : 0));
+    }
+  }
+
+  // ...and every indexed window that has a workspace must be in its list.
+  num_indexed_windows = 0;
+  g_hash_table_foreach (screen->windows_by_xid, check_indexed_window,
+    &num_indexed_windows);
+  g_assert (num_listed_windows == num_indexed_windows);
+  g_assert (num_listed_windows == (int) screen->window_table->len);
 }
+#endif
 
 //------------------------------------------------------------------------------
 
-SSWorkspace *
-ss_screen_get_workspace_for_wnck_window (SSScreen *screen, WnckWindow *wnck_window)
+int
+ss_screen_get_workspace_id_for_geometry (SSScreen *screen, WnckWorkspace *wnck_workspace, GdkRectangle *r)
 {
-  int x, y, w, h;
   int vx;
   int n;
+  if (wnck_workspace == NULL) {
+    return -1;
+  }
   if (window_manager_uses_viewports) {
-    wnck_window_get_geometry (wnck_window, &x, &y, &w, &h);
-    vx = wnck_workspace_get_viewport_x (wnck_window_get_workspace (wnck_window));
-    n = (vx + x + (w / 2)) / screen->screen_width;
+    vx = wnck_workspace_get_viewport_x (wnck_workspace);
+    n = (vx + r->x + (r->width / 2)) / screen->screen_width;
     if (n < 0) {
       n = 0;
     } else if (n >= screen->num_workspaces) {
       n = screen->num_workspaces - 1;
     }
   } else {
-    n = wnck_workspace_get_number (wnck_window_get_workspace (wnck_window));
+    n = wnck_workspace_get_number (wnck_workspace);
   }
-  return ss_screen_get_nth_workspace (screen, n);
+  return n;
+}
+
+//------------------------------------------------------------------------------
+
+SSWorkspace *
+ss_screen_get_workspace_for_wnck_window (SSScreen *screen, WnckWindow *wnck_window)
+{
+  SSWindow *window;
+  GdkRectangle r;
+
+  window = lookup_ss_window (screen, wnck_window);
+  if (window != NULL) {
+    return ss_screen_get_nth_workspace (screen, window->workspace_id);
+  }
+
+  // We have no snapshot for a window that we have not yet seen.
+  wnck_window_get_geometry (wnck_window, &r.x, &r.y, &r.width, &r.height);
+  return ss_screen_get_nth_workspace (screen, ss_screen_get_workspace_id_for_geometry (
+    screen, wnck_window_get_workspace (wnck_window), &r));
 }
 
 //------------------------------------------------------------------------------
@@ -123,7 +202,182 @@ ss_screen_get_workspace_for_wnck_window (SSScreen *screen, WnckWindow *wnck_wind
 SSWorkspace *
 ss_screen_get_nth_workspace (SSScreen *screen, int n)
 {
-  return (SSWorkspace *) g_list_nth_data (screen->workspaces, n);
+  if ((n < 0) || (n >= (int) screen->workspaces->len)) {
+    return NULL;
+  }
+  return (SSWorkspace *) g_ptr_array_index (screen->workspaces, n);
+}
+
+//------------------------------------------------------------------------------
+
+SSWorkspace *
+ss_screen_get_highlighted_workspace (SSScreen *screen)
+{
+  if (screen->selected_workspace_id != -1) {
+    return ss_screen_get_nth_workspace (screen, screen->selected_workspace_id);
+  }
+  if (screen->selected_window != NULL) {
+    return screen->selected_window->workspace;
+  }
+  return screen->active_workspace;
+}
+
+//------------------------------------------------------------------------------
+
+SSWindow *
+ss_screen_get_highlighted_window (SSScreen *screen)
+{
+  if (screen->selected_window != NULL) {
+    return screen->selected_window;
+  }
+  return screen->active_window;
+}
+
+//------------------------------------------------------------------------------
+
+#define BULK_MOVE_TIMEOUT_MS 500
+
+static gboolean
+return_true (gpointer key, gpointer value, gpointer data)
+{
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+static void
+finish_bulk_move (SSScreen *screen)
+{
+  SSWindow *window;
+  guint i;
+
+  if (screen->bulk_move_source_id != 0) {
+    g_source_remove (screen->bulk_move_source_id);
+    screen->bulk_move_source_id = 0;
+  }
+
+  // Any window that the window manager did not move (or has not moved yet)
+  // simply stays where it was.
+  for (i = 0; i < screen->bulk_moved_windows->len; i++) {
+    window = (SSWindow *) g_ptr_array_index (screen->bulk_moved_windows, i);
+    window->is_bulk_moving = FALSE;
+    ss_window_update_geometry (window);
+    ss_window_update_for_new_workspace (window,
+      ss_screen_get_nth_workspace (screen, window->workspace_id));
+  }
+  g_ptr_array_set_size (screen->bulk_moved_windows, 0);
+  g_hash_table_foreach_remove (screen->bulk_move_targets, return_true, NULL);
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+on_bulk_move_timeout (gpointer data)
+{
+  SSScreen *screen;
+  screen = (SSScreen *) data;
+  screen->bulk_move_source_id = 0;
+  finish_bulk_move (screen);
+  return FALSE;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_begin_bulk_move (SSScreen *screen)
+{
+  ss_batch_begin (screen->batch);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_bulk_move_window (SSScreen *screen, SSWindow *window, SSWorkspace *workspace)
+{
+  if ((window->workspace == workspace) || (window->workspace == NULL)) {
+    return;
+  }
+
+  // A window that has already arrived from an earlier, unfinished, bulk
+  // move is no longer awaited, but is still listed.
+  if (!window->is_bulk_moving) {
+    window->is_bulk_moving = TRUE;
+    g_ptr_array_add (screen->bulk_moved_windows, window);
+  }
+  g_hash_table_insert (screen->bulk_move_targets, window, workspace);
+
+  if (window_manager_uses_viewports) {
+    ss_window_move_to_workspace (window, workspace);
+  } else {
+    ss_batch_move_to_workspace (screen->batch, window, workspace);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_end_bulk_move (SSScreen *screen)
+{
+  ss_batch_end (screen->batch);
+
+  if (screen->bulk_move_source_id != 0) {
+    g_source_remove (screen->bulk_move_source_id);
+    screen->bulk_move_source_id = 0;
+  }
+  if (g_hash_table_size (screen->bulk_move_targets) > 0) {
+    screen->bulk_move_source_id =
+      g_timeout_add (BULK_MOVE_TIMEOUT_MS, on_bulk_move_timeout, screen);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_move_windows (SSScreen *screen, SSWorkspace *from_workspace, SSWorkspace *to_workspace)
+{
+  SSWindow **windows;
+  guint num_windows;
+  guint i;
+
+  if ((from_workspace == NULL) || (from_workspace == to_workspace)) {
+    return;
+  }
+
+  // We work from a snapshot, rather than from from_workspace->windows, which
+  // will change as the moved windows arrive at to_workspace.
+  num_windows = from_workspace->windows->len;
+  windows = g_new (SSWindow *, num_windows);
+  memcpy (windows, from_workspace->windows->pdata, num_windows * sizeof (SSWindow *));
+
+  ss_screen_begin_bulk_move (screen);
+  for (i = 0; i < num_windows; i++) {
+    ss_screen_bulk_move_window (screen, windows[i], to_workspace);
+  }
+  ss_screen_end_bulk_move (screen);
+  g_free (windows);
+}
+
+//------------------------------------------------------------------------------
+
+// Called when a window's workspace (or, with viewports, geometry) changes,
+// and returns whether that window is part of a bulk move, in which case the
+// model is left alone until finish_bulk_move.
+gboolean
+ss_screen_on_bulk_moved_window_changed (SSScreen *screen, SSWindow *window)
+{
+  SSWorkspace *target;
+
+  target = (SSWorkspace *) g_hash_table_lookup (screen->bulk_move_targets, window);
+  if (target == NULL) {
+    return FALSE;
+  }
+  if (ss_screen_get_nth_workspace (screen, window->workspace_id) == target) {
+    g_hash_table_remove (screen->bulk_move_targets, window);
+    if (g_hash_table_size (screen->bulk_move_targets) == 0) {
+      finish_bulk_move (screen);
+    }
+  }
+  return TRUE;
 }
 
 //------------------------------------------------------------------------------
@@ -132,19 +386,12 @@ void
 ss_screen_change_active_workspace_to (SSScreen *screen, WnckWorkspace *wnck_workspace, int viewport,
   gboolean also_bring_active_window, gboolean all_not_just_current_window, guint32 time)
 {
-  GList *i;
-  SSWindow *window;
   SSWorkspace *workspace;
 
   if (also_bring_active_window) {
     workspace = get_ss_workspace_from_wnck_workspace (screen, wnck_workspace, viewport);
     if (all_not_just_current_window) {
-      if (screen->active_workspace != NULL) {
-        for (i = screen->active_workspace->windows; i; i = i->next) {
-          window = (SSWindow *) i->data;
-          ss_window_move_to_workspace (window, workspace);
-        }
-      }
+      ss_screen_move_windows (screen, screen->active_workspace, workspace);
     } else {
       if (screen->active_window != NULL) {
         ss_window_move_to_workspace (screen->active_window, workspace);
@@ -202,17 +449,141 @@ ss_screen_change_active_workspace (SSScreen *screen, int n, gboolean also_bring_
 //------------------------------------------------------------------------------
 
 static void
-update_search (SSScreen *screen, SSWindow *window, gchar** terms)
+set_selected_window (SSScreen *screen, SSWindow *window)
+{
+  SSWindow *old_window;
+
+  old_window = ss_screen_get_highlighted_window (screen);
+  screen->selected_window = window;
+  if (old_window != NULL) {
+    ss_screen_queue_window_update (screen, old_window, SS_WINDOW_DIRTY_SELECTED);
+  }
+  window = ss_screen_get_highlighted_window (screen);
+  if (window != NULL) {
+    ss_screen_queue_window_update (screen, window, SS_WINDOW_DIRTY_SELECTED);
+  }
+  ss_screen_queue_redraw (screen);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_select_workspace (SSScreen *screen, int n,
+  gboolean also_bring_active_window, gboolean all_not_just_current_window)
+{
+  if ((n < 0) || (n >= screen->num_workspaces)) {
+    return;
+  }
+
+  // A window selected on the previous workspace is left behind.
+  if (screen->selected_window != NULL) {
+    set_selected_window (screen, NULL);
+  }
+  screen->selected_workspace_id = n;
+  screen->selected_also_bring_active_window = also_bring_active_window;
+  screen->selected_all_not_just_current_window = all_not_just_current_window;
+  ss_screen_queue_redraw (screen);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_select_workspace_by_delta (SSScreen *screen, int delta,
+  gboolean also_bring_active_window, gboolean all_not_just_current_window)
+{
+  int w, n;
+
+  if (screen->selected_workspace_id != -1) {
+    w = screen->selected_workspace_id;
+  } else {
+    w = screen->active_workspace_id == -1 ? 0 : screen->active_workspace_id;
+  }
+  w += delta;
+  n = screen->num_workspaces;
+
+  while (w < 0) {
+    w += n;
+  }
+  while (w >= n) {
+    w -= n;
+  }
+
+  ss_screen_select_workspace (screen, w,
+    also_bring_active_window, all_not_just_current_window);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_select_window (SSScreen *screen, SSWindow *window)
+{
+  if (screen->selected_window != window) {
+    set_selected_window (screen, window);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_commit_selection (SSScreen *screen, guint32 time)
+{
+  SSWindow *window;
+  gboolean is_coming_along;
+  int n;
+
+  window = screen->selected_window;
+  n = screen->selected_workspace_id;
+  if ((window == NULL) && (n == -1)) {
+    return;
+  }
+
+  // The highlight goes back to following the active workspace and window,
+  // which catch up once the window manager has done what we ask of it.
+  screen->selected_workspace_id = -1;
+  set_selected_window (screen, NULL);
+
+  if (window == NULL) {
+    // Only a workspace was selected.
+    ss_screen_change_active_workspace (screen, n,
+      screen->selected_also_bring_active_window,
+      screen->selected_all_not_just_current_window, time);
+  } else if ((n != -1) && screen->selected_also_bring_active_window) {
+    // A workspace was selected with Shift, and then a window.  Just as if
+    // the keys had been acted upon one at a time, the active window (or, with
+    // Ctrl, every window on the active workspace) is brought to workspace n,
+    // and then the selected window is activated, which, unless it is on (or
+    // coming to) workspace n, means going on to its own workspace.
+    is_coming_along = (window == screen->active_window) ||
+      (screen->selected_all_not_just_current_window &&
+       (window->workspace == screen->active_workspace));
+    ss_screen_change_active_workspace (screen, n, TRUE,
+      screen->selected_all_not_just_current_window, time);
+    if (is_coming_along ||
+        (window->workspace == ss_screen_get_nth_workspace (screen, n))) {
+      ss_window_activate_window (window, time + 1, TRUE);
+    } else {
+      ss_window_activate_workspace_and_window (window, time + 1, TRUE);
+    }
+  } else if (window->workspace == screen->active_workspace) {
+    // Any workspace selected (without Shift) before the window is
+    // superseded by the window's own workspace.
+    ss_window_activate_window (window, time, TRUE);
+  } else {
+    ss_window_activate_workspace_and_window (window, time, TRUE);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static void
+update_search (SSScreen *screen, SSWindowTableEntry *entry, gchar** terms)
 {
   gboolean matched;
-  char* title;
   gchar* term;
   int t;
 
-  title = (char *) wnck_window_get_name (window->wnck_window);
-  if (title != NULL) {
+  if (entry->title != NULL) {
     matched = TRUE;
-    title = g_ascii_strdown (title, strlen (title));
     t = 0;
     while (terms[t] != NULL) {
       term = terms[t];
@@ -220,17 +591,18 @@ update_search (SSScreen *screen, SSWindow *window, gchar** terms)
       if (strlen(term) == 0) {
         continue;
       }
-      if (g_strrstr (title, term) == NULL) {
+      if (g_strrstr (entry->title, term) == NULL) {
         matched = FALSE;
         break;
       }
     }
-    g_free (title);
   } else {
     matched = FALSE;
   }
 
-  ss_window_set_sensitive (window, matched);
+  if (entry->sensitive != (matched ? 1 : 0)) {
+    ss_window_set_sensitive (entry->window, matched);
+  }
   if (matched) {
     screen->num_search_matches++;
   }
@@ -238,31 +610,190 @@ update_search (SSScreen *screen, SSWindow *window, gchar** terms)
 
 //------------------------------------------------------------------------------
 
+static void
+reset_search (SSScreen *screen)
+{
+  SSWindowTableEntry *entry;
+  guint i;
+
+  screen->num_search_matches = screen->window_table->len;
+  if (!screen->search_is_active) {
+    return;
+  }
+
+  // Only those windows that the last search did not match need changing.
+  for (i = 0; i < screen->window_table->len; i++) {
+    entry = &g_array_index (screen->window_table, SSWindowTableEntry, i);
+    if (!entry->sensitive) {
+      ss_window_set_sensitive (entry->window, TRUE);
+    }
+  }
+  screen->search_is_active = FALSE;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_update_search (SSScreen *screen, const char *query)
+{
+  char *normalized_query;
+  gchar** terms;
+  const char *c;
+  guint i;
+
+  // A query of nothing but spaces matches every window, so there is no need
+  // to look at any titles.
+  for (c = query; *c == ' '; c++) {
+  }
+  if (*c == '\0') {
+    reset_search (screen);
+    return;
+  }
+  screen->search_is_active = TRUE;
+
+  normalized_query = g_ascii_strdown (query, strlen (query));
+  terms = g_strsplit (normalized_query, " ", 0);
+  screen->num_search_matches = 0;
+
+  for (i = 0; i < screen->window_table->len; i++) {
+    update_search (screen,
+      &g_array_index (screen->window_table, SSWindowTableEntry, i), terms);
+  }
+
+  g_strfreev (terms);
+  g_free (normalized_query);
+}
+
+//------------------------------------------------------------------------------
+
+static char *
+normalize_title (SSWindow *window)
+{
+  const char *title;
+  title = wnck_window_get_name (window->wnck_window);
+  if (title == NULL) {
+    return NULL;
+  }
+  return g_ascii_strdown (title, strlen (title));
+}
+
+//------------------------------------------------------------------------------
+
+// Renumbers the rows from row onwards, after rows have been inserted into or
+// removed from workspace's part of the table, and moves the first row of each
+// workspace after that one along by delta.
+static void
+shift_window_table (SSScreen *screen, SSWorkspace *workspace, int row, int delta)
+{
+  SSWorkspace *w;
+  gboolean is_after;
+  guint i;
+
+  for (i = row; i < screen->window_table->len; i++) {
+    g_array_index (screen->window_table, SSWindowTableEntry, i).window->table_index = i;
+  }
+  is_after = FALSE;
+  for (i = 0; i < screen->workspaces->len; i++) {
+    w = (SSWorkspace *) g_ptr_array_index (screen->workspaces, i);
+    if (is_after) {
+      w->first_table_index += delta;
+    } else if (w == workspace) {
+      is_after = TRUE;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_insert_window_table_row (SSScreen *screen, SSWorkspace *workspace, SSWindow *window)
+{
+  SSWindowTableEntry entry;
+  int row;
+
+  // The window has just been appended to the workspace's list, and so its
+  // row goes at the end of that workspace's part of the table.
+  row = workspace->first_table_index + workspace->windows->len - 1;
+  entry.window = window;
+  entry.title = normalize_title (window);
+  entry.sensitive = window->sensitive;
+  g_array_insert_val (screen->window_table, row, entry);
+  shift_window_table (screen, workspace, row, 1);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_remove_window_table_row (SSScreen *screen, SSWorkspace *workspace, SSWindow *window)
+{
+  int row;
+
+  row = window->table_index;
+  if (row == -1) {
+    return;
+  }
+  g_free (g_array_index (screen->window_table, SSWindowTableEntry, row).title);
+  g_array_remove_index (screen->window_table, row);
+  window->table_index = -1;
+  shift_window_table (screen, workspace, row, -1);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_move_window_table_row (SSScreen *screen, SSWorkspace *workspace, int old_index, int new_index)
+{
+  SSWindowTableEntry *entries;
+  SSWindowTableEntry moved;
+  int i;
+
+  // A window has been re-ordered within a workspace, so only the rows in
+  // that workspace's part of the table, between old_index and new_index,
+  // change.  This mirrors the shuffle in ss_workspace_reorder_window.
+  entries = &g_array_index (screen->window_table, SSWindowTableEntry,
+    workspace->first_table_index);
+  moved = entries[old_index];
+  if (old_index < new_index) {
+    for (i = old_index; i < new_index; i++) {
+      entries[i] = entries[i + 1];
+    }
+  } else {
+    for (i = old_index; i > new_index; i--) {
+      entries[i] = entries[i - 1];
+    }
+  }
+  entries[new_index] = moved;
+  for (i = MIN (old_index, new_index); i <= MAX (old_index, new_index); i++) {
+    entries[i].window->table_index = workspace->first_table_index + i;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_update_window_table_title (SSScreen *screen, SSWindow *window)
+{
+  SSWindowTableEntry *entry;
+
+  if (window->table_index == -1) {
+    return;
+  }
+  entry = &g_array_index (screen->window_table, SSWindowTableEntry,
+    window->table_index);
+  g_free (entry->title);
+  entry->title = normalize_title (window);
+}
+
+//------------------------------------------------------------------------------
+
 void
-ss_screen_update_search (SSScreen *screen, const char *query)
+ss_screen_update_window_table_sensitive (SSScreen *screen, SSWindow *window)
 {
-  char *normalized_query;
-  gchar** terms;
-  SSWorkspace *workspace;
-  SSWindow *window;
-  GList *i;
-  GList *j;
-
-  normalized_query = g_ascii_strdown (query, strlen (query));
-  terms = g_strsplit (normalized_query, " ", 0);
-  screen->num_search_matches = 0;
-
-  for (i = screen->workspaces; i; i = i->next) {
-    workspace = (SSWorkspace *) i->data;
-    for (j = workspace->windows; j; j = j->next) {
-      window = (SSWindow *) j->data;
-
-      update_search (screen, window, terms);
-    }
+  if (window->table_index == -1) {
+    return;
   }
-
-  g_strfreev (terms);
-  g_free (normalized_query);
+  g_array_index (screen->window_table, SSWindowTableEntry,
+    window->table_index).sensitive = window->sensitive;
 }
 
 //------------------------------------------------------------------------------
@@ -270,34 +801,48 @@ ss_screen_update_search (SSScreen *screen, const char *query)
 void
 ss_screen_activate_next_window (SSScreen *screen, gboolean backwards, guint32 time)
 {
-  SSWorkspace *workspace;
-  SSWindow *window;
-  GList *i;
-  GList *j;
+  SSWindowTableEntry *entries;
+  int n;
+  int k;
+  int active_index;
+  int start_index;
 
-  SSWindow *first_sensitive_window;
-  SSWindow *previous_sensitive_window;
+  int first_sensitive_index;
+  int previous_sensitive_index;
   gboolean should_activate_last_sensitive_window;
   gboolean should_activate_next_sensitive_window;
-  gboolean found_active_window;
 
   gboolean also_warp_pointer_if_necessary;
 
-  first_sensitive_window    = NULL;
-  previous_sensitive_window = NULL;
+  entries = (SSWindowTableEntry *) screen->window_table->data;
+  n = screen->window_table->len;
+
+  // If there is an active window, we cycle from its row.  If not, we cycle
+  // from just before the active workspace's first row.
+  active_index = -1;
+  start_index = -1;
+  if (screen->active_window != NULL) {
+    if (screen->active_window->workspace != NULL) {
+      active_index = screen->active_window->table_index;
+    }
+  } else if (screen->active_workspace != NULL) {
+    start_index = screen->active_workspace->first_table_index;
+  }
+
+  first_sensitive_index    = -1;
+  previous_sensitive_index = -1;
   should_activate_last_sensitive_window = FALSE;
   should_activate_next_sensitive_window = FALSE;
-  found_active_window = FALSE;
   also_warp_pointer_if_necessary = TRUE;
 
-  for (i = screen->workspaces; i; i = i->next) {
-    workspace = (SSWorkspace *) i->data;
-    if ((screen->active_window == NULL) && (screen->active_workspace == workspace)) {
+  for (k = 0; k <= n; k++) {
+    if (k == start_index) {
       if (backwards) {
-        if (previous_sensitive_window == NULL) {
+        if (previous_sensitive_index == -1) {
           should_activate_last_sensitive_window = TRUE;
         } else {
-          ss_window_activate_workspace_and_window (previous_sensitive_window, time,
+          ss_window_activate_workspace_and_window (
+            entries[previous_sensitive_index].window, time,
             also_warp_pointer_if_necessary);
           return;
         }
@@ -305,51 +850,50 @@ ss_screen_activate_next_window (SSScreen *screen, gboolean backwards, guint32 ti
         should_activate_next_sensitive_window = TRUE;
       }
     }
-    for (j = workspace->windows; j; j = j->next) {
-      window = (SSWindow *) j->data;
+    if (k == n) {
+      break;
+    }
 
-      if (screen->active_window != NULL) {
-        found_active_window = (window == screen->active_window);
+    if (backwards && (k == active_index)) {
+      if (previous_sensitive_index == -1) {
+        should_activate_last_sensitive_window = TRUE;
+      } else {
+        ss_window_activate_workspace_and_window (
+          entries[previous_sensitive_index].window, time,
+          also_warp_pointer_if_necessary);
+        return;
       }
+    }
 
-      if (backwards && found_active_window) {
-        if (previous_sensitive_window == NULL) {
-          should_activate_last_sensitive_window = TRUE;
-        } else {
-          ss_window_activate_workspace_and_window (previous_sensitive_window, time,
-            also_warp_pointer_if_necessary);
-          return;
-        }
+    if (entries[k].sensitive) {
+      if (should_activate_next_sensitive_window) {
+        ss_window_activate_workspace_and_window (entries[k].window, time,
+          also_warp_pointer_if_necessary);
+        return;
       }
 
-      if (window->sensitive) {
-        if (should_activate_next_sensitive_window) {
-          ss_window_activate_workspace_and_window (window, time,
-            also_warp_pointer_if_necessary);
-          return;
-        }
-
-        previous_sensitive_window = window;
+      previous_sensitive_index = k;
 
-        if (first_sensitive_window == NULL) {
-          first_sensitive_window = window;
-        }
+      if (first_sensitive_index == -1) {
+        first_sensitive_index = k;
       }
+    }
 
-      if (!backwards && found_active_window) {
-        should_activate_next_sensitive_window = TRUE;
-      }
+    if (!backwards && (k == active_index)) {
+      should_activate_next_sensitive_window = TRUE;
     }
   }
 
-  if (should_activate_next_sensitive_window) {
-    ss_window_activate_workspace_and_window (first_sensitive_window, time,
+  if (should_activate_next_sensitive_window && (first_sensitive_index != -1)) {
+    ss_window_activate_workspace_and_window (
+      entries[first_sensitive_index].window, time,
       also_warp_pointer_if_necessary);
     return;
   }
 
-  if (should_activate_last_sensitive_window) {
-    ss_window_activate_workspace_and_window (previous_sensitive_window, time,
+  if (should_activate_last_sensitive_window && (previous_sensitive_index != -1)) {
+    ss_window_activate_workspace_and_window (
+      entries[previous_sensitive_index].window, time,
       also_warp_pointer_if_necessary);
     return;
   }
@@ -357,121 +901,272 @@ ss_screen_activate_next_window (SSScreen *screen, gboolean backwards, guint32 ti
 
 //------------------------------------------------------------------------------
 
+static void
+mru_move_to_front (SSScreen *screen, SSWindow *window)
+{
+  if ((window == NULL) || (window->mru_link == screen->mru_windows->head)) {
+    return;
+  }
+  g_queue_unlink (screen->mru_windows, window->mru_link);
+  g_queue_push_head_link (screen->mru_windows, window->mru_link);
+}
+
+//------------------------------------------------------------------------------
+
 void
-ss_screen_activate_next_window_in_stacking_order (SSScreen *screen, gboolean backwards, guint32 time)
+ss_screen_freeze_mru (SSScreen *screen)
 {
-  WnckWindow *active_wnck_window;
-  WnckWindow *wnck_window;
-  gboolean ww_is_aww;
-  WnckWorkspace *active_wnck_workspace;
-  WnckWorkspace *wnck_workspace;
-  int active_workspace_id;
-  int workspace_id;
-  GList *i;
-  int num_windows;
+  screen->mru_is_frozen = TRUE;
+}
 
-  WnckWindow *first_eligible_wnck_window;
-  WnckWindow *previous_eligible_wnck_window;
-  gboolean should_activate_last_eligible_wnck_window;
-  gboolean should_activate_next_eligible_wnck_window;
-  
-  gboolean also_warp_pointer_if_necessary;
-  also_warp_pointer_if_necessary = TRUE;
+//------------------------------------------------------------------------------
 
-  num_windows = g_list_length (screen->active_workspace->windows);
-  if (num_windows == 0) {
-    return;
-  }
+void
+ss_screen_thaw_mru (SSScreen *screen)
+{
+  screen->mru_is_frozen = FALSE;
+  mru_move_to_front (screen, screen->active_window);
+}
 
-  // TODO - this is probably an ugly hack that's exposed to a potential
-  // race condition.  A better way to go about this would be to suppress
-  // the window_stacking_change signal, I suppose.
-  // For example, if a window gets opened in between setting this flag
-  // and in the event handler on_window_stacking_changed, then the
-  // window_stacking_order list will be copied at the wrong point,
-  // possibly.
-  screen->should_ignore_next_window_stacking_change = TRUE;
+//------------------------------------------------------------------------------
 
-  first_eligible_wnck_window    = NULL;
-  previous_eligible_wnck_window = NULL;
-  should_activate_last_eligible_wnck_window = FALSE;
-  should_activate_next_eligible_wnck_window = FALSE;
+#define UPDATE_INTERVAL_MS    40
+#define UPDATE_HOLD_SETTLE_MS 50
+#define UPDATE_HOLD_MAX_MS    250
 
-  if (screen->active_window != NULL) {
-    active_wnck_window = screen->active_window->wnck_window;
+static gboolean
+on_update_timeout (gpointer data)
+{
+  SSScreen *screen;
+  screen = (SSScreen *) data;
+  screen->update_source_id = 0;
+  ss_screen_flush_updates (screen);
+  return FALSE;
+}
+
+//------------------------------------------------------------------------------
+
+static void schedule_update (SSScreen *screen);
+
+static gboolean
+on_update_hold_timeout (gpointer data)
+{
+  SSScreen *screen;
+  screen = (SSScreen *) data;
+  screen->update_hold_source_id = 0;
+  if (screen->redraw_is_pending) {
+    schedule_update (screen);
+  }
+  return FALSE;
+}
+
+//------------------------------------------------------------------------------
+
+static void
+schedule_update (SSScreen *screen)
+{
+  int ms;
+  if (screen->update_hold_source_id != 0) {
+    // Every update asked for whilst held back pushes the end of the hold
+    // out a little further, up to a point.
+    if (g_timer_elapsed (screen->time_since_hold, NULL) * 1000 < UPDATE_HOLD_MAX_MS) {
+      g_source_remove (screen->update_hold_source_id);
+      screen->update_hold_source_id =
+        g_timeout_add (UPDATE_HOLD_SETTLE_MS, on_update_hold_timeout, screen);
+    }
+    return;
+  }
+  if (!screen->is_visible || screen->update_source_id != 0) {
+    return;
+  }
+  ms = UPDATE_INTERVAL_MS -
+    (int) (1000 * g_timer_elapsed (screen->time_since_last_update, NULL));
+  if (ms > 0) {
+    screen->update_source_id = g_timeout_add (ms, on_update_timeout, screen);
   } else {
-    active_wnck_window = NULL;
+    // This runs before GTK+'s own resize and redraw idle handlers.
+    screen->update_source_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+      on_update_timeout, screen, NULL);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_queue_window_update (SSScreen *screen, SSWindow *window, guint dirty_flags)
+{
+  if (window->dirty_flags == 0) {
+    g_ptr_array_add (screen->dirty_windows, window);
   }
-  active_wnck_workspace = wnck_screen_get_active_workspace (screen->wnck_screen);
-  active_workspace_id = (active_wnck_workspace != NULL) ? wnck_workspace_get_number (active_wnck_workspace) : -1;
+  window->dirty_flags |= dirty_flags;
+  ss_screen_queue_redraw (screen);
+}
 
-  // Note that wnck_windows_in_stacking_order is in bottom-to-top
-  // order, so that if we're searching forwards (just like Alt-Tab)
-  // then we want the previous_eligible_wnck_window.  This is the
-  // opposite ordering than in ss_screen_activate_next_window.
-  for (i = screen->wnck_windows_in_stacking_order; i; i = i->next) {
-    wnck_window = (WnckWindow *) i->data;
-    wnck_workspace = wnck_window_get_workspace (wnck_window);
-    workspace_id = (wnck_workspace != NULL) ? wnck_workspace_get_number (wnck_workspace) : -1;
+//------------------------------------------------------------------------------
+
+void
+ss_screen_queue_redraw (SSScreen *screen)
+{
+  screen->redraw_is_pending = TRUE;
+  schedule_update (screen);
+}
+
+//------------------------------------------------------------------------------
 
-    if (workspace_id != active_workspace_id) {
+// A column whose windows have come or gone is re-packed in one pass,
+// however many of them there are.  A window that has only been re-ordered
+// within its column is moved on its own, unless another window in that
+// column has been too, in which case (since one move could undo another's)
+// the whole column is re-packed after all.
+static void
+flush_window_widgets (SSScreen *screen)
+{
+  SSWindow *window;
+  SSWindow *other_window;
+  GSList *updated_workspaces;
+  guint i, j;
+
+  updated_workspaces = NULL;
+  for (i = 0; i < screen->dirty_windows->len; i++) {
+    window = (SSWindow *) g_ptr_array_index (screen->dirty_windows, i);
+    if (!(window->dirty_flags & SS_WINDOW_DIRTY_PARENT)) {
       continue;
     }
-
-    if (active_wnck_window != NULL) {
-      ww_is_aww = (wnck_window_get_xid (wnck_window) ==
-        wnck_window_get_xid (active_wnck_window));
-    } else {
-      ww_is_aww = FALSE;
+    if (window->workspace == NULL) {
+      if (window->widget->parent != NULL) {
+        gtk_container_remove (GTK_CONTAINER (window->widget->parent),
+          window->widget);
+      }
+    } else if (!g_slist_find (updated_workspaces, window->workspace)) {
+      ss_workspace_update_window_widgets (window->workspace);
+      updated_workspaces = g_slist_prepend (updated_workspaces, window->workspace);
     }
+  }
 
-    // We've found the active window, and we're searching forwards.
-    if (!backwards && ww_is_aww) {
-      if (previous_eligible_wnck_window == NULL) {
-        should_activate_last_eligible_wnck_window = TRUE;
-      } else {
-        ss_window_activate_window (get_ss_window_from_wnck_window (
-          screen, previous_eligible_wnck_window), time,
-          also_warp_pointer_if_necessary);
-        return;
+  for (i = 0; i < screen->dirty_windows->len; i++) {
+    window = (SSWindow *) g_ptr_array_index (screen->dirty_windows, i);
+    if (!(window->dirty_flags & SS_WINDOW_DIRTY_POSITION) ||
+        (window->workspace == NULL) ||
+        g_slist_find (updated_workspaces, window->workspace)) {
+      continue;
+    }
+    for (j = i + 1; j < screen->dirty_windows->len; j++) {
+      other_window = (SSWindow *) g_ptr_array_index (screen->dirty_windows, j);
+      if ((other_window->dirty_flags & SS_WINDOW_DIRTY_POSITION) &&
+          (other_window->workspace == window->workspace)) {
+        break;
       }
     }
-
-    if (should_activate_next_eligible_wnck_window) {
-      ss_window_activate_window (get_ss_window_from_wnck_window (
-        screen, wnck_window), time, also_warp_pointer_if_necessary);
-      return;
+    if (j < screen->dirty_windows->len) {
+      ss_workspace_update_window_widgets (window->workspace);
+      updated_workspaces = g_slist_prepend (updated_workspaces, window->workspace);
+    } else {
+      ss_workspace_update_window_widget_position (window->workspace, window);
     }
+  }
+  g_slist_free (updated_workspaces);
+}
 
-    previous_eligible_wnck_window = wnck_window;
+//------------------------------------------------------------------------------
 
-    if (first_eligible_wnck_window == NULL) {
-      first_eligible_wnck_window = wnck_window;
-    }
+void
+ss_screen_flush_updates (SSScreen *screen)
+{
+  guint i;
 
-    // We've found the active window, and we're searching backwards.
-    if (backwards && ww_is_aww) {
-      should_activate_next_eligible_wnck_window = TRUE;
-    }
+  if (screen->update_source_id != 0) {
+    g_source_remove (screen->update_source_id);
+    screen->update_source_id = 0;
   }
 
-  if (active_wnck_window == NULL) {
-    if (backwards) {
-      should_activate_next_eligible_wnck_window = TRUE;
-    } else {
-      should_activate_last_eligible_wnck_window = TRUE;
-    }
+  flush_window_widgets (screen);
+  for (i = 0; i < screen->dirty_windows->len; i++) {
+    ss_window_flush_updates ((SSWindow *) g_ptr_array_index (screen->dirty_windows, i));
   }
+  g_ptr_array_set_size (screen->dirty_windows, 0);
 
-  if (should_activate_next_eligible_wnck_window) {
-    ss_window_activate_window (get_ss_window_from_wnck_window (
-      screen, first_eligible_wnck_window), time, also_warp_pointer_if_necessary);
-    return;
+  if (screen->redraw_is_pending) {
+    screen->redraw_is_pending = FALSE;
+    gtk_widget_queue_draw (gtk_widget_get_toplevel (screen->widget));
+  }
+  g_timer_start (screen->time_since_last_update);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_set_visible (SSScreen *screen, gboolean visible)
+{
+  screen->is_visible = visible;
+  if (visible) {
+    ss_screen_flush_updates (screen);
+  } else if (screen->update_source_id != 0) {
+    g_source_remove (screen->update_source_id);
+    screen->update_source_id = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_hold_updates (SSScreen *screen)
+{
+  if (screen->update_hold_source_id != 0) {
+    g_source_remove (screen->update_hold_source_id);
   }
+  if (screen->update_source_id != 0) {
+    g_source_remove (screen->update_source_id);
+    screen->update_source_id = 0;
+  }
+  g_timer_start (screen->time_since_hold);
+  screen->update_hold_source_id =
+    g_timeout_add (UPDATE_HOLD_SETTLE_MS, on_update_hold_timeout, screen);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_activate_next_window_in_mru_order (SSScreen *screen, gboolean backwards,
+                                             gboolean all_workspaces, gboolean select_only,
+                                             guint32 time)
+{
+  SSWindow *highlighted_window;
+  SSWorkspace *workspace;
+  SSWindow *window;
+  GList *i;
+  guint n;
+
+  // Just like Alt-Tab, searching forwards from the active window (at or near
+  // the front of the list) goes to the next most recently used window.  With
+  // no active window, we start from the front (or, backwards, the back).  If
+  // a window has been selected but not yet activated, we carry on from it.
+  highlighted_window = ss_screen_get_highlighted_window (screen);
+  workspace = ss_screen_get_highlighted_workspace (screen);
+  i = (highlighted_window != NULL) ? highlighted_window->mru_link : NULL;
+  for (n = g_queue_get_length (screen->mru_windows); n > 0; n--) {
+    if (backwards) {
+      i = ((i != NULL) && (i->prev != NULL)) ? i->prev : screen->mru_windows->tail;
+    } else {
+      i = ((i != NULL) && (i->next != NULL)) ? i->next : screen->mru_windows->head;
+    }
+    window = (SSWindow *) i->data;
+    if (window == highlighted_window) {
+      return;
+    }
+    if (window->workspace == NULL) {
+      continue;
+    }
+    if ((window->workspace != workspace) && !all_workspaces) {
+      continue;
+    }
 
-  if (should_activate_last_eligible_wnck_window) {
-    ss_window_activate_window (get_ss_window_from_wnck_window (
-      screen, previous_eligible_wnck_window), time, also_warp_pointer_if_necessary);
+    if (select_only) {
+      ss_screen_select_window (screen, window);
+    } else if (window->workspace == screen->active_workspace) {
+      ss_window_activate_window (window, time, TRUE);
+    } else {
+      ss_window_activate_workspace_and_window (window, time, TRUE);
+    }
     return;
   }
 }
@@ -482,12 +1177,11 @@ static void
 update_workspace_titles (SSScreen *screen)
 {
   SSWorkspace *workspace;
-  GList *i;
-  int j;
+  guint i;
 
-  for (j = 0, i = screen->workspaces; i; j++, i = i->next) {
-    workspace = (SSWorkspace *) i->data;
-    workspace->title = (j < NUMBER_OF_F_KEYS) ? f_keys[j] : "";
+  for (i = 0; i < screen->workspaces->len; i++) {
+    workspace = (SSWorkspace *) g_ptr_array_index (screen->workspaces, i);
+    workspace->title = (i < NUMBER_OF_F_KEYS) ? f_keys[i] : "";
   }
 }
 
@@ -504,11 +1198,13 @@ update_for_active_window (SSScreen *screen)
 
   if (screen->active_window != window) {
     if (screen->active_window != NULL) {
-      ss_window_set_selected (screen->active_window, FALSE);
+      ss_screen_queue_window_update (screen, screen->active_window,
+        SS_WINDOW_DIRTY_SELECTED);
     }
     screen->active_window = window;
     if (screen->active_window != NULL) {
-      ss_window_set_selected (screen->active_window, TRUE);
+      ss_screen_queue_window_update (screen, screen->active_window,
+        SS_WINDOW_DIRTY_SELECTED);
     }
   }
 }
@@ -545,7 +1241,13 @@ add_workspace_to_screen (SSScreen *screen, WnckWorkspace *wnck_workspace, int vi
 {
   SSWorkspace *workspace;
   workspace = ss_workspace_new (screen, wnck_workspace, viewport);
-  screen->workspaces = g_list_append (screen->workspaces, workspace);
+  g_ptr_array_add (screen->workspaces, workspace);
+  // A new workspace is always the last, and has no windows yet.
+  workspace->first_table_index = screen->window_table->len;
+  if (!window_manager_uses_viewports) {
+    g_hash_table_insert (screen->workspaces_by_wnck_workspace,
+      wnck_workspace, workspace);
+  }
   gtk_box_pack_start (GTK_BOX (screen->widget),
     workspace->widget, FALSE, FALSE, 0);
   return workspace;
@@ -571,16 +1273,26 @@ add_window_to_screen (SSScreen *screen, WnckWindow *wnck_window)
   }
   workspace = ss_screen_get_workspace_for_wnck_window (screen, wnck_window);
   window = ss_window_new (workspace, wnck_window);
+  g_hash_table_insert (screen->windows_by_xid,
+    GUINT_TO_POINTER (wnck_window_get_xid (wnck_window)), window);
+  g_queue_push_tail (screen->mru_windows, window);
+  window->mru_link = screen->mru_windows->tail;
   if (wnck_window_is_active (wnck_window)) {
     if (screen->active_window != NULL) {
-      ss_window_set_selected (screen->active_window, FALSE);
+      ss_screen_queue_window_update (screen, screen->active_window,
+        SS_WINDOW_DIRTY_SELECTED);
     }
     screen->active_window = window;
     if (screen->active_window != NULL) {
-      ss_window_set_selected (screen->active_window, TRUE);
+      ss_screen_queue_window_update (screen, screen->active_window,
+        SS_WINDOW_DIRTY_SELECTED);
+    }
+    if (!screen->mru_is_frozen) {
+      mru_move_to_front (screen, window);
     }
   }
   ss_workspace_add_window (workspace, window);
+  ss_screen_check_consistency (screen);
   return window;
 }
 
@@ -591,17 +1303,28 @@ update_window_label_width (SSScreen *screen)
 {
   PangoContext *context;
   PangoFontMetrics *metrics;
+  PangoFontDescription *font_desc;
   int width, char_width;
   SSWorkspace *workspace;
   SSWindow *window;
-  GList *i;
-  GList *j;
-
-  context = gtk_widget_get_pango_context (screen->widget);
-  metrics = pango_context_get_metrics (context,
-    screen->widget->style->font_desc, NULL);
-  char_width = PANGO_PIXELS (pango_font_metrics_get_approximate_char_width (metrics));
-  pango_font_metrics_unref (metrics);
+  guint i;
+  guint j;
+
+  // Font metrics are expensive to compute, and only change with the font.
+  font_desc = screen->widget->style->font_desc;
+  if ((screen->label_font_desc == NULL) ||
+      !pango_font_description_equal (screen->label_font_desc, font_desc)) {
+    context = gtk_widget_get_pango_context (screen->widget);
+    metrics = pango_context_get_metrics (context, font_desc, NULL);
+    screen->label_char_width = PANGO_PIXELS (
+      pango_font_metrics_get_approximate_char_width (metrics));
+    pango_font_metrics_unref (metrics);
+    if (screen->label_font_desc != NULL) {
+      pango_font_description_free (screen->label_font_desc);
+    }
+    screen->label_font_desc = pango_font_description_copy (font_desc);
+  }
+  char_width = MAX (screen->label_char_width, 1);
 
   // The widget should be slightly less wide than the screen.  This is
   // completely arbitrary, but it looks OK on my machine.
@@ -611,12 +1334,17 @@ update_window_label_width (SSScreen *screen)
   // convert from pixels to chars.
   width /= char_width;
 
+  // Every label has the same width, so if that has not changed, then no
+  // label needs touching.
+  if (width == screen->label_max_width_chars) {
+    return;
+  }
   screen->label_max_width_chars = width;
 
-  for (i = screen->workspaces; i; i = i->next) {
-    workspace = (SSWorkspace *) i->data;
-    for (j = workspace->windows; j; j = j->next) {
-      window = (SSWindow *) j->data;
+  for (i = 0; i < screen->workspaces->len; i++) {
+    workspace = (SSWorkspace *) g_ptr_array_index (screen->workspaces, i);
+    for (j = 0; j < workspace->windows->len; j++) {
+      window = (SSWindow *) g_ptr_array_index (workspace->windows, j);
       ss_window_update_label_max_width_chars (window);
     }
   }
@@ -642,8 +1370,9 @@ on_viewports_changed (WnckScreen *wnck_screen, gpointer data)
     wnck_window = (WnckWindow *) i->data;
     window = get_ss_window_from_wnck_window (screen, wnck_window);
     if (window) {
+      ss_window_update_geometry (window);
       ss_window_update_for_new_workspace (
-        window, ss_screen_get_workspace_for_wnck_window (screen, wnck_window));
+        window, ss_screen_get_nth_workspace (screen, window->workspace_id));
     }
   }
   g_signal_emit (screen, active_workspace_changed_signal, 0, NULL);
@@ -662,6 +1391,9 @@ on_active_window_changed (WnckScreen *wnck_screen, gpointer data)
   SSScreen *screen;
   screen = (SSScreen *) data;
   update_for_active_window (screen);
+  if (!screen->mru_is_frozen) {
+    mru_move_to_front (screen, screen->active_window);
+  }
   g_signal_emit (screen, active_window_changed_signal, 0, NULL);
 }
 
@@ -687,23 +1419,43 @@ on_window_closed (WnckScreen *wnck_screen, WnckWindow *wnck_window, gpointer dat
 {
   SSScreen *screen;
   SSWindow *window;
-  WnckWorkspace *wnck_workspace;
-  int n;
 
   screen = (SSScreen *) data;
-  window = get_ss_window_from_wnck_window (screen, wnck_window);
+  ss_stacking_remove (&screen->stacking, wnck_window);
+
+  window = lookup_ss_window (screen, wnck_window);
   if (window == NULL) {
     return;
   }
-  wnck_workspace = wnck_window_get_workspace (wnck_window);
-  if (wnck_workspace != NULL) {
-    n = wnck_workspace_get_number (wnck_workspace);
-    ss_workspace_remove_window (ss_screen_get_nth_workspace (screen, n), window);
+  if (window->workspace != NULL) {
+    ss_workspace_remove_window (window->workspace, window);
+  }
+  // The window is going, so its widget cannot wait for the next flush.
+  if (window->widget->parent != NULL) {
+    gtk_container_remove (GTK_CONTAINER (window->widget->parent), window->widget);
+  }
+  g_hash_table_remove (screen->windows_by_xid,
+    GUINT_TO_POINTER (wnck_window_get_xid (wnck_window)));
+  g_queue_delete_link (screen->mru_windows, window->mru_link);
+  if (window->dirty_flags != 0) {
+    g_ptr_array_remove_fast (screen->dirty_windows, window);
   }
 
   if (screen->active_window == window) {
     screen->active_window = NULL;
   }
+  if (screen->selected_window == window) {
+    screen->selected_window = NULL;
+  }
+  // If the bulk move was only waiting for this window, it is now done.
+  if (window->is_bulk_moving) {
+    g_ptr_array_remove (screen->bulk_moved_windows, window);
+  }
+  if (g_hash_table_remove (screen->bulk_move_targets, window) &&
+      (g_hash_table_size (screen->bulk_move_targets) == 0)) {
+    finish_bulk_move (screen);
+  }
+  ss_screen_check_consistency (screen);
 
   g_signal_emit (screen, window_closed_signal, 0, window);
   ss_window_free (window);
@@ -728,32 +1480,48 @@ on_window_opened (WnckScreen *wnck_screen, WnckWindow *wnck_window, gpointer dat
 
 //------------------------------------------------------------------------------
 
+static gboolean
+is_skip_pager (gpointer wnck_window)
+{
+  return wnck_window_is_skip_pager (WNCK_WINDOW (wnck_window));
+}
+
+//------------------------------------------------------------------------------
+
 void
 ss_screen_update_wnck_windows_in_stacking_order (SSScreen *screen)
 {
-  WnckWindow *wnck_window;
-  GList *i;
+  ss_stacking_update (&screen->stacking,
+    wnck_screen_get_windows_stacked (screen->wnck_screen), is_skip_pager);
+  screen->workspace_stacking_is_dirty = TRUE;
+}
 
-  if (screen->wnck_windows_in_stacking_order != NULL) {
-    g_list_free (screen->wnck_windows_in_stacking_order);
-    screen->wnck_windows_in_stacking_order = NULL;
-  }
+//------------------------------------------------------------------------------
 
-  // Make a copy of wnck_screen_get_windows_stacked (screen->wnck_screen),
-  // filtering out those windows that we do not show.
-  for (i = wnck_screen_get_windows_stacked (screen->wnck_screen); i; i = i->next) {
-    wnck_window = (WnckWindow *) i->data;
-    if (wnck_window_is_skip_pager (wnck_window)) {
-      continue;
-    }
+void
+ss_screen_update_workspace_stacking (SSScreen *screen)
+{
+  SSWorkspace *workspace;
+  SSWindow *window;
+  GList *i;
+  guint j;
 
-    screen->wnck_windows_in_stacking_order = g_list_append
-      (screen->wnck_windows_in_stacking_order, wnck_window);
+  if (!screen->workspace_stacking_is_dirty) {
+    return;
   }
 
-  for (i = screen->wnck_windows_in_stacking_order; i; i = i->next) {
-    wnck_window = (WnckWindow *) i->data;
+  // Partition the screen-wide stacking order by workspace, in one pass.
+  for (j = 0; j < screen->workspaces->len; j++) {
+    workspace = (SSWorkspace *) g_ptr_array_index (screen->workspaces, j);
+    g_ptr_array_set_size (workspace->windows_in_stacking_order, 0);
   }
+  for (i = screen->stacking.head; i; i = i->next) {
+    window = get_ss_window_from_wnck_window (screen, (WnckWindow *) i->data);
+    if (window != NULL) {
+      g_ptr_array_add (window->workspace->windows_in_stacking_order, window);
+    }
+  }
+  screen->workspace_stacking_is_dirty = FALSE;
 }
 
 //------------------------------------------------------------------------------
@@ -763,13 +1531,32 @@ on_window_stacking_changed (WnckScreen *wnck_screen, gpointer data)
 {
   SSScreen *screen;
   screen = (SSScreen *) data;
+  ss_screen_update_wnck_windows_in_stacking_order (screen);
+}
 
-  if (screen->should_ignore_next_window_stacking_change) {
-    screen->should_ignore_next_window_stacking_change = FALSE;
-    return;
-  }
+//------------------------------------------------------------------------------
 
-  ss_screen_update_wnck_windows_in_stacking_order (screen);
+static GdkFilterReturn
+on_x_event (GdkXEvent *gdk_xevent, GdkEvent *event, gpointer data)
+{
+  SSScreen *screen;
+  XEvent *x_event;
+  SSWindow *window;
+
+  screen = (SSScreen *) data;
+  x_event = (XEvent *) gdk_xevent;
+
+  // libwnck already selects PropertyChangeMask on every client window, so we
+  // get told when a window's _NET_FRAME_EXTENTS change.
+  if ((x_event->type == PropertyNotify) &&
+      (x_event->xproperty.atom == screen->xinerama->net_frame_extents_atom)) {
+    window = (SSWindow *) g_hash_table_lookup (screen->windows_by_xid,
+      GUINT_TO_POINTER (x_event->xproperty.window));
+    if (window != NULL) {
+      window->frame_extents_are_valid = FALSE;
+    }
+  }
+  return GDK_FILTER_CONTINUE;
 }
 
 //------------------------------------------------------------------------------
@@ -777,11 +1564,11 @@ on_window_stacking_changed (WnckScreen *wnck_screen, gpointer data)
 SSWorkspace *
 ss_screen_find_workspace_near_point (SSScreen *screen, int x, int y)
 {
-  GList *i;
+  guint i;
   SSWorkspace *workspace;
   workspace = NULL;
-  for (i = screen->workspaces; i; i = i->next) {
-    workspace = (SSWorkspace *) i->data;
+  for (i = 0; i < screen->workspaces->len; i++) {
+    workspace = (SSWorkspace *) g_ptr_array_index (screen->workspaces, i);
     if (x < (workspace->widget->allocation.x +
       workspace->widget->allocation.width +
       WORKSPACE_COLUMN_SPACING)) {
@@ -807,7 +1594,32 @@ on_workspace_created (WnckScreen *wnck_screen, WnckWorkspace *wnck_workspace, gp
   update_window_label_width (screen);
   update_workspace_titles (screen);
   g_signal_emit (screen, workspace_created_signal, 0, workspace);
-  gtk_widget_queue_draw (gtk_widget_get_toplevel (screen->widget));
+  ss_screen_queue_redraw (screen);
+}
+
+//------------------------------------------------------------------------------
+
+// The window manager should have moved every window off a workspace before
+// destroying it, but any that are left lose their rows in the window table.
+static void
+remove_window_table_rows (SSScreen *screen, SSWorkspace *workspace)
+{
+  SSWindowTableEntry *entry;
+  int n;
+  int i;
+
+  n = workspace->windows->len;
+  if (n == 0) {
+    return;
+  }
+  for (i = 0; i < n; i++) {
+    entry = &g_array_index (screen->window_table, SSWindowTableEntry,
+      workspace->first_table_index + i);
+    entry->window->table_index = -1;
+    g_free (entry->title);
+  }
+  g_array_remove_range (screen->window_table, workspace->first_table_index, n);
+  shift_window_table (screen, workspace, workspace->first_table_index, -n);
 }
 
 //------------------------------------------------------------------------------
@@ -819,16 +1631,27 @@ on_workspace_destroyed (WnckScreen *wnck_screen, WnckWorkspace *wnck_workspace,
   SSWorkspace *workspace;
 
   screen = (SSScreen *) data;
+
+  // A bulk move may still be taking windows off the workspace that is going
+  // (such as when deleting a workspace), so it is wrapped up first.
+  if (screen->bulk_moved_windows->len > 0) {
+    finish_bulk_move (screen);
+  }
+
   screen->num_workspaces -= 1;
   workspace = get_ss_workspace_from_wnck_workspace (screen, wnck_workspace, 0);
-  screen->workspaces = g_list_remove (screen->workspaces, workspace);
+  remove_window_table_rows (screen, workspace);
+  g_ptr_array_remove (screen->workspaces, workspace);
+  if (!window_manager_uses_viewports) {
+    g_hash_table_remove (screen->workspaces_by_wnck_workspace, wnck_workspace);
+  }
 
   update_window_label_width (screen);
   update_workspace_titles (screen);
   g_signal_emit (screen, workspace_destroyed_signal, 0, workspace);
   gtk_container_remove (GTK_CONTAINER (screen->widget), workspace->widget);
   ss_workspace_free (workspace);
-  gtk_widget_queue_draw (gtk_widget_get_toplevel (screen->widget));
+  ss_screen_queue_redraw (screen);
 }
 
 //------------------------------------------------------------------------------
@@ -989,6 +1812,7 @@ ss_screen_new (WnckScreen *wnck_screen, Display *x_display, Window x_root_window
   SSScreen *screen;
 
   GList *wnck_windows;
+  GList *l;
   int i;
 
   wnck_screen_force_update (wnck_screen);
@@ -997,6 +1821,8 @@ ss_screen_new (WnckScreen *wnck_screen, Display *x_display, Window x_root_window
   screen = (SSScreen *) g_object_new (SS_TYPE_SCREEN, NULL);
   screen->wnck_screen = wnck_screen;
   screen->xinerama = ss_xinerama_new (x_display, x_root_window);
+  screen->batch = ss_batch_new (screen, x_display, x_root_window);
+  gdk_window_add_filter (NULL, on_x_event, screen);
   screen->screen_width  = wnck_screen_get_width (wnck_screen);
   screen->screen_height = wnck_screen_get_height (wnck_screen);
   screen->screen_aspect = (double) screen->screen_height / (double) screen->screen_width;
@@ -1013,15 +1839,43 @@ ss_screen_new (WnckScreen *wnck_screen, Display *x_display, Window x_root_window
   screen->active_workspace = NULL;
   screen->active_workspace_id = -1;
 
-  screen->wnck_windows_in_stacking_order = NULL;
-  screen->should_ignore_next_window_stacking_change = FALSE;
+  screen->selected_workspace_id = -1;
+  screen->selected_also_bring_active_window = FALSE;
+  screen->selected_all_not_just_current_window = FALSE;
+  screen->selected_window = NULL;
+
+  screen->workspaces = g_ptr_array_new ();
+  screen->workspaces_by_wnck_workspace = g_hash_table_new (g_direct_hash, g_direct_equal);
+  screen->windows_by_xid = g_hash_table_new (g_direct_hash, g_direct_equal);
+  screen->window_table = g_array_new (FALSE, FALSE, sizeof (SSWindowTableEntry));
+
+  ss_stacking_init (&screen->stacking);
+  screen->workspace_stacking_is_dirty = TRUE;
   ss_screen_update_wnck_windows_in_stacking_order (screen);
 
+  screen->mru_windows = g_queue_new ();
+  screen->mru_is_frozen = FALSE;
+
+  screen->is_visible = FALSE;
+  screen->dirty_windows = g_ptr_array_new ();
+  screen->redraw_is_pending = FALSE;
+  screen->update_source_id = 0;
+  screen->time_since_last_update = g_timer_new ();
+  screen->update_hold_source_id = 0;
+  screen->time_since_hold = g_timer_new ();
+
+  screen->bulk_moved_windows = g_ptr_array_new ();
+  screen->bulk_move_targets = g_hash_table_new (g_direct_hash, g_direct_equal);
+  screen->bulk_move_source_id = 0;
+
   screen->num_search_matches = 0;
+  screen->search_is_active = FALSE;
 
   screen->drag_and_drop = ss_draganddrop_new (screen);
 
   screen->label_max_width_chars = 256;
+  screen->label_font_desc = NULL;
+  screen->label_char_width = 0;
   update_window_label_width (screen);
 
 #ifndef HAVE_GTK_2_11
@@ -1034,7 +1888,6 @@ ss_screen_new (WnckScreen *wnck_screen, Display *x_display, Window x_root_window
 #endif
 
   // Add existing workspaces, and then existing windows
-  screen->workspaces = NULL;
   for (i = 0; i < screen->num_workspaces; i++) {
     if (window_manager_uses_viewports) {
       add_workspace_to_screen (screen, wnck_screen_get_workspace (wnck_screen, 0), i);
@@ -1049,6 +1902,14 @@ ss_screen_new (WnckScreen *wnck_screen, Display *x_display, Window x_root_window
     add_window_to_screen (screen, WNCK_WINDOW (wnck_windows->data));
   }
 
+  // We have no focus history for those windows that were already open, so
+  // the best guess is that the higher a window is stacked, the more recently
+  // it was used.
+  for (l = screen->stacking.head; l; l = l->next) {
+    mru_move_to_front (screen, lookup_ss_window (screen, (WnckWindow *) l->data));
+  }
+  mru_move_to_front (screen, screen->active_window);
+
   // Listen for new workspaces, and new windows
   g_signal_connect (G_OBJECT (wnck_screen), "active_window_changed",
     G_CALLBACK (on_active_window_changed),
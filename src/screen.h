@@ -11,6 +11,7 @@
 #include <X11/Xlib.h>
 
 #include "forward_declarations.h"
+#include "stacking.h"
 
 #define SS_TYPE_SCREEN            (ss_screen_get_type ())
 #define SS_SCREEN(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), SS_TYPE_SCREEN, SSScreen))
@@ -19,11 +20,24 @@
 #define SS_IS_SCREEN_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  SS_TYPE_SCREEN))
 #define SS_SCREEN_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  SS_TYPE_SCREEN, SSScreenClass))
 
+// One row of the screen's window table, which holds every window that is on
+// a workspace, grouped by workspace, in the order that they are shown.  It
+// copies just what the window cycling and search passes read (the title is
+// lower-cased, ready to be searched), so that they can scan one packed array
+// without going through wnck.  Rows are inserted, removed and moved as windows
+// come, go and are re-ordered; see ss_screen_insert_window_table_row.
+struct _SSWindowTableEntry {
+  SSWindow *   window;
+  char *       title;
+  guint        sensitive : 1;
+};
+
 struct _SSScreen {
   GObject   parent_instance; // Unused.
 
   WnckScreen *   wnck_screen;
   SSXinerama *   xinerama;
+  SSBatch *      batch;
   int            screen_width;
   int            screen_height;
   double         screen_aspect;
@@ -31,22 +45,89 @@ struct _SSScreen {
   // The widget is also the workspace_container
   GtkWidget *   widget;
 
-  GList *   workspaces;
-  int       num_workspaces;
+  // The workspaces, in order, and (unless the window manager uses viewports,
+  // in which case every workspace shares the one WnckWorkspace) a map from
+  // each WnckWorkspace to its SSWorkspace.
+  GPtrArray *    workspaces;
+  GHashTable *   workspaces_by_wnck_workspace;
+  int            num_workspaces;
+
+  // Every SSWindow (including those on no workspace), keyed by X window ID.
+  GHashTable *   windows_by_xid;
+
+  // An array of SSWindowTableEntry.
+  GArray *   window_table;
 
   SSWindow *      active_window;
   SSWorkspace *   active_workspace;
   int             active_workspace_id;
 
-  GList *    wnck_windows_in_stacking_order;
-  gboolean   should_ignore_next_window_stacking_change;
+  // Where keyboard navigation has moved to but not yet gone, while a burst
+  // of autorepeated key presses is coalesced into one activation, or (with
+  // --switch-windows-on-release or --switch-workspaces-on-release) until
+  // Super is released.  The popup highlights these instead of the active
+  // workspace and window, until ss_screen_commit_selection.  -1 and NULL
+  // mean that nothing is selected.
+  int          selected_workspace_id;
+  gboolean     selected_also_bring_active_window;
+  gboolean     selected_all_not_just_current_window;
+  SSWindow *   selected_window;
+
+  // The (shown) WnckWindows, bottom-to-top, in stacking.head.
+  SSStacking     stacking;
+  // Set whenever the stacking order, or a window's workspace, changes, so
+  // that each SSWorkspace's windows_in_stacking_order is rebuilt before the
+  // next time that it is painted.
+  gboolean       workspace_stacking_is_dirty;
+
+  // Every SSWindow, most recently active first.  While the popup is up, this
+  // is frozen, so that Super-Tab cycles through a stable order, and the
+  // then-active window moves to the front when the popup goes away.
+  GQueue *     mru_windows;
+  gboolean     mru_is_frozen;
+
+  // Changes to window widgets (see SSWindow's dirty_flags), and redraws of
+  // the popup, are not made as each wnck signal arrives, but once the main
+  // loop is idle, and then no more often than every UPDATE_INTERVAL_MS.
+  // A storm of signals then costs one update per changed window.  While the
+  // popup is hidden (is_visible is FALSE), they are not made at all, until
+  // ss_screen_set_visible brings everything up to date in one pass.
+  gboolean      is_visible;
+  GPtrArray *   dirty_windows;
+  gboolean      redraw_is_pending;
+  guint         update_source_id;
+  GTimer *      time_since_last_update;
+  // After a batch of window manager requests (see SSBatch), updates are held
+  // back until UPDATE_HOLD_SETTLE_MS goes by without any wnck signal asking
+  // for one (or UPDATE_HOLD_MAX_MS has gone by in all).
+  guint         update_hold_source_id;
+  GTimer *      time_since_hold;
+
+  // The windows that a bulk move (see ss_screen_begin_bulk_move) has asked
+  // the window manager to move, and, for those that have not arrived yet, a
+  // map to the SSWorkspace that each is bound for.  Until the last of them
+  // arrives (or BULK_MOVE_TIMEOUT_MS goes by), their workspace-changed
+  // signals are only counted, and then the model is brought up to date for
+  // all of them in one pass.
+  GPtrArray *    bulk_moved_windows;
+  GHashTable *   bulk_move_targets;
+  guint          bulk_move_source_id;
 
   int   num_search_matches;
 
+  // Whether the last search had a non-blank query, and so might have left
+  // some windows insensitive.
+  gboolean   search_is_active;
+
   SSDragAndDrop *   drag_and_drop;
 
   int   label_max_width_chars;
 
+  // The font that label_char_width (its approximate character width, in
+  // pixels) was measured for.
+  PangoFontDescription *   label_font_desc;
+  int                      label_char_width;
+
 #ifndef HAVE_GTK_2_11
   GtkTooltips *   tooltips;
 #endif
@@ -62,17 +143,50 @@ struct _SSScreenClass {
 GType        ss_screen_get_type   (void);
 SSScreen *   ss_screen_new        (WnckScreen *wnck_screen, Display *x_display, Window x_root_window);
 
-SSWorkspace *   ss_screen_get_nth_workspace   (SSScreen *screen, int n);
+SSWorkspace *   ss_screen_get_nth_workspace           (SSScreen *screen, int n);
+SSWorkspace *   ss_screen_get_highlighted_workspace   (SSScreen *screen);
+SSWindow *      ss_screen_get_highlighted_window      (SSScreen *screen);
 
 void   ss_screen_activate_next_window                     (SSScreen *screen, gboolean backwards, guint32 time);
-void   ss_screen_activate_next_window_in_stacking_order   (SSScreen *screen, gboolean backwards, guint32 time);
+void   ss_screen_activate_next_window_in_mru_order        (SSScreen *screen, gboolean backwards, gboolean all_workspaces, gboolean select_only, guint32 time);
+void   ss_screen_freeze_mru                               (SSScreen *screen);
+void   ss_screen_thaw_mru                                 (SSScreen *screen);
 void   ss_screen_change_active_workspace                  (SSScreen *screen, int n, gboolean also_bring_active_window, gboolean all_not_just_current_window, guint32 time);
 void   ss_screen_change_active_workspace_by_delta         (SSScreen *screen, int delta, gboolean also_bring_active_window, gboolean all_not_just_current_window, guint32 time);
 void   ss_screen_change_active_workspace_to               (SSScreen *screen, WnckWorkspace *wnck_workspace, int viewport, gboolean also_bring_active_window, gboolean all_not_just_current_window, guint32 time);
+void   ss_screen_select_workspace                         (SSScreen *screen, int n, gboolean also_bring_active_window, gboolean all_not_just_current_window);
+void   ss_screen_select_workspace_by_delta                (SSScreen *screen, int delta, gboolean also_bring_active_window, gboolean all_not_just_current_window);
+void   ss_screen_select_window                            (SSScreen *screen, SSWindow *window);
+void   ss_screen_commit_selection                         (SSScreen *screen, guint32 time);
+void   ss_screen_begin_bulk_move                          (SSScreen *screen);
+void   ss_screen_bulk_move_window                         (SSScreen *screen, SSWindow *window, SSWorkspace *workspace);
+void   ss_screen_end_bulk_move                            (SSScreen *screen);
+void   ss_screen_move_windows                             (SSScreen *screen, SSWorkspace *from_workspace, SSWorkspace *to_workspace);
 void   ss_screen_update_search                            (SSScreen *screen, const char *query);
+void   ss_screen_queue_window_update                      (SSScreen *screen, SSWindow *window, guint dirty_flags);
+void   ss_screen_queue_redraw                             (SSScreen *screen);
+void   ss_screen_flush_updates                            (SSScreen *screen);
+void   ss_screen_set_visible                              (SSScreen *screen, gboolean visible);
+void   ss_screen_hold_updates                             (SSScreen *screen);
 void   ss_screen_update_wnck_windows_in_stacking_order    (SSScreen *screen);
+void   ss_screen_update_workspace_stacking                (SSScreen *screen);
+void   ss_screen_insert_window_table_row                  (SSScreen *screen, SSWorkspace *workspace, SSWindow *window);
+void   ss_screen_remove_window_table_row                  (SSScreen *screen, SSWorkspace *workspace, SSWindow *window);
+void   ss_screen_move_window_table_row                    (SSScreen *screen, SSWorkspace *workspace, int old_index, int new_index);
+void   ss_screen_update_window_table_title                (SSScreen *screen, SSWindow *window);
+void   ss_screen_update_window_table_sensitive            (SSScreen *screen, SSWindow *window);
+
+// Verifies that the screen's lookup tables agree with its workspace and
+// window lists.  This is a no-op unless configured with --enable-debug.
+#ifdef ENABLE_DEBUG
+void   ss_screen_check_consistency   (SSScreen *screen);
+#else
+#define ss_screen_check_consistency(screen)
+#endif
 
 SSWorkspace *   ss_screen_get_workspace_for_wnck_window   (SSScreen *screen, WnckWindow *wnck_window);
+gboolean        ss_screen_on_bulk_moved_window_changed    (SSScreen *screen, SSWindow *window);
+int             ss_screen_get_workspace_id_for_geometry   (SSScreen *screen, WnckWorkspace *wnck_workspace, GdkRectangle *r);
 
 SSWorkspace *   ss_screen_find_workspace_near_point   (SSScreen *screen, int x, int y);
 #endif
@@ -0,0 +1,146 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#include "stacking.h"
+
+//------------------------------------------------------------------------------
+
+static void
+stacking_unlink (SSStacking *stacking, GList *link)
+{
+  if (link->prev != NULL) {
+    link->prev->next = link->next;
+  } else if (stacking->head == link) {
+    stacking->head = link->next;
+  }
+  if (link->next != NULL) {
+    link->next->prev = link->prev;
+  }
+  link->prev = NULL;
+  link->next = NULL;
+}
+
+//------------------------------------------------------------------------------
+
+static void
+stacking_link_after (SSStacking *stacking, GList *link, GList *after)
+{
+  if (after != NULL) {
+    link->prev = after;
+    link->next = after->next;
+    after->next = link;
+  } else {
+    link->prev = NULL;
+    link->next = stacking->head;
+    stacking->head = link;
+  }
+  if (link->next != NULL) {
+    link->next->prev = link;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static void
+stacking_free_link (SSStacking *stacking, GList *link)
+{
+  g_hash_table_remove (stacking->links, link->data);
+  g_list_free_1 (link);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_stacking_init (SSStacking *stacking)
+{
+  stacking->head = NULL;
+  stacking->links = g_hash_table_new (g_direct_hash, g_direct_equal);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_stacking_update (SSStacking *stacking, GList *stacked, SSStackingFilterFunc is_filtered_out)
+{
+  GList *i;
+  GList *last;
+  GList *next;
+  GList *link;
+  GList *set_aside;
+
+  // Rather than re-copying stacked (less those windows that are filtered out)
+  // from scratch, we walk it alongside our copy, and only unlink and re-link
+  // those windows that have moved.  Typically, a restack moves only one
+  // window, so this touches only one link.
+  last = NULL;
+  set_aside = NULL;
+  for (i = stacked; i; i = i->next) {
+    if (is_filtered_out (i->data)) {
+      continue;
+    }
+
+    // The common case: this window has not moved.
+    next = (last != NULL) ? last->next : stacking->head;
+    if ((next != NULL) && (next->data == i->data)) {
+      last = next;
+      continue;
+    }
+
+    // If the window after next is this one, then it is next that has moved
+    // (e.g. it was raised), so set next aside.  It gets re-linked when we come
+    // across it further up the stack.
+    if ((next != NULL) && (next->next != NULL) && (next->next->data == i->data)) {
+      last = next->next;
+      stacking_unlink (stacking, next);
+      set_aside = g_list_prepend (set_aside, next);
+      continue;
+    }
+
+    // Otherwise, this window has moved (e.g. it was lowered), or is new.
+    link = (GList *) g_hash_table_lookup (stacking->links, i->data);
+    if (link != NULL) {
+      stacking_unlink (stacking, link);
+    } else {
+      link = g_list_alloc ();
+      link->data = i->data;
+      g_hash_table_insert (stacking->links, i->data, link);
+    }
+    stacking_link_after (stacking, link, last);
+    last = link;
+  }
+
+  // Whatever is left above the last window placed, or was set aside and
+  // never re-linked, is no longer (shown) on the screen.
+  if (last != NULL) {
+    next = last->next;
+    last->next = NULL;
+  } else {
+    next = stacking->head;
+    stacking->head = NULL;
+  }
+  while (next != NULL) {
+    link = next;
+    next = next->next;
+    stacking_free_link (stacking, link);
+  }
+  for (i = set_aside; i; i = i->next) {
+    link = (GList *) i->data;
+    if ((link->prev == NULL) && (link != stacking->head)) {
+      stacking_free_link (stacking, link);
+    }
+  }
+  g_list_free (set_aside);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_stacking_remove (SSStacking *stacking, gpointer window)
+{
+  GList *link;
+  link = (GList *) g_hash_table_lookup (stacking->links, window);
+  if (link != NULL) {
+    stacking_unlink (stacking, link);
+    stacking_free_link (stacking, link);
+  }
+}
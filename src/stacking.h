@@ -0,0 +1,27 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#ifndef SUPERSWITCHER_STACKING_H
+#define SUPERSWITCHER_STACKING_H
+
+#include <glib.h>
+
+#include "forward_declarations.h"
+
+// A copy of the window manager's stacking order (bottom-to-top), less those
+// windows that are filtered out, with a map from each window to its link in
+// the copy, so that a restack can be applied in place rather than by copying
+// the whole list afresh.  It knows nothing of wnck (the windows are just
+// pointers), so that tests/restack_bench can run it without an X server.
+struct _SSStacking {
+  GList *        head;
+  GHashTable *   links;
+};
+
+typedef gboolean (* SSStackingFilterFunc) (gpointer window);
+
+void   ss_stacking_init     (SSStacking *stacking);
+void   ss_stacking_update   (SSStacking *stacking, GList *stacked, SSStackingFilterFunc is_filtered_out);
+void   ss_stacking_remove   (SSStacking *stacking, gpointer window);
+
+#endif
@@ -0,0 +1,284 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <gtk/gtk.h>
+
+//------------------------------------------------------------------------------
+
+// We keep the most recent NUM_SAMPLES samples for each stage, so that the
+// percentiles reflect how things are now, not how they were at startup.
+#define NUM_SAMPLES 1024
+
+typedef struct _SSStatsSamples SSStatsSamples;
+struct _SSStatsSamples {
+  gint64   samples[NUM_SAMPLES];
+  int      num_samples;
+  int      next_sample;
+};
+
+//------------------------------------------------------------------------------
+
+gboolean collect_stats = FALSE;
+
+static const char *stage_names[SS_STATS_NUM_STAGES] = {
+  "X server to filter_func",
+  "key press to popup shown",
+  "key press to first expose",
+  "key press to action done",
+};
+
+static SSStatsSamples stages[SS_STATS_NUM_STAGES];
+
+static gint64 key_press_time = 0;
+
+// When the popup started being shown for a key press, or 0 if it was not
+// shown for one.  This is cleared once the first expose has been timed.
+static gint64 show_time = 0;
+
+// The smallest difference seen between our clock and the X server's (both in
+// milliseconds).  Since the two clocks do not share an epoch, the X server
+// stage is measured relative to this, rather than absolutely.
+static gint64 min_x_time_offset = 0;
+static gboolean have_min_x_time_offset = FALSE;
+
+static int signal_pipe[2] = { -1, -1 };
+static GIOChannel *signal_channel = NULL;
+static guint signal_watch_id = 0;
+
+//------------------------------------------------------------------------------
+
+static gint64
+get_monotonic_time_in_microseconds (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (((gint64) ts.tv_sec) * 1000000) + (ts.tv_nsec / 1000);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+add_sample (SSStatsStage stage, gint64 sample)
+{
+  SSStatsSamples *s;
+  s = &stages[stage];
+  s->samples[s->next_sample] = sample;
+  s->next_sample = (s->next_sample + 1) % NUM_SAMPLES;
+  if (s->num_samples < NUM_SAMPLES) {
+    s->num_samples++;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_stats_key_press (guint32 x_time)
+{
+  gint64 offset;
+
+  if (!collect_stats) {
+    return;
+  }
+
+  key_press_time = get_monotonic_time_in_microseconds ();
+
+  // X server timestamps are a 32-bit millisecond count that wraps around
+  // every 49 days or so, which is rare enough that we just start afresh.
+  offset = (key_press_time / 1000) - x_time;
+  if (!have_min_x_time_offset || offset < min_x_time_offset ||
+      offset - min_x_time_offset > G_MAXINT32) {
+    min_x_time_offset = offset;
+    have_min_x_time_offset = TRUE;
+  }
+  add_sample (SS_STATS_X_SERVER_TO_FILTER, 1000 * (offset - min_x_time_offset));
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_stats_begin_show (gboolean after_delay)
+{
+  if (!collect_stats) {
+    return;
+  }
+  // Waiting out --popup-delay is deliberate, and so is not counted.
+  show_time = after_delay ? get_monotonic_time_in_microseconds () : key_press_time;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_stats_end_show (void)
+{
+  show_time = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_stats_mark (SSStatsStage stage)
+{
+  gint64 start_time;
+
+  if (!collect_stats) {
+    return;
+  }
+  if (stage == SS_STATS_KEY_PRESS_TO_ACTION_DONE) {
+    start_time = key_press_time;
+  } else {
+    start_time = show_time;
+  }
+  if (start_time == 0) {
+    return;
+  }
+  add_sample (stage, get_monotonic_time_in_microseconds () - start_time);
+
+  // A later expose (or a show over D-Bus) has nothing to do with this key
+  // press, and nor does anything after its action is done.
+  if (stage == SS_STATS_KEY_PRESS_TO_FIRST_EXPOSE) {
+    show_time = 0;
+  } else if (stage == SS_STATS_KEY_PRESS_TO_ACTION_DONE) {
+    key_press_time = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static int
+compare_samples (const void *a, const void *b)
+{
+  gint64 x, y;
+  x = *((const gint64 *) a);
+  y = *((const gint64 *) b);
+  return (x < y) ? -1 : ((x > y) ? +1 : 0);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_stats_dump (void)
+{
+  gint64 sorted[NUM_SAMPLES];
+  SSStatsSamples *s;
+  int i, n;
+
+  if (!collect_stats) {
+    return;
+  }
+
+  g_printerr ("SuperSwitcher stats, in microseconds, over the last %d samples:\n",
+              NUM_SAMPLES);
+  g_printerr ("  %-28s %6s %8s %8s %8s %8s\n",
+              "stage", "count", "p50", "p95", "p99", "max");
+  for (i = 0; i < SS_STATS_NUM_STAGES; i++) {
+    s = &stages[i];
+    n = s->num_samples;
+    if (n == 0) {
+      g_printerr ("  %-28s %6d\n", stage_names[i], 0);
+      continue;
+    }
+
+    memcpy (sorted, s->samples, n * sizeof (gint64));
+    qsort (sorted, n, sizeof (gint64), compare_samples);
+    g_printerr ("  %-28s %6d %8" G_GINT64_FORMAT " %8" G_GINT64_FORMAT
+                " %8" G_GINT64_FORMAT " %8" G_GINT64_FORMAT "\n",
+                stage_names[i], n,
+                sorted[(n * 50) / 100],
+                sorted[(n * 95) / 100],
+                sorted[(n * 99) / 100],
+                sorted[n - 1]);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Signal handlers may only do async-signal-safe things, so we just pass the
+// signal number down a pipe, to be picked up by the main loop.
+static void
+on_signal (int signal_number)
+{
+  unsigned char c;
+  int saved_errno;
+
+  saved_errno = errno;
+  c = (unsigned char) signal_number;
+  if ((write (signal_pipe[1], &c, 1) != 1) && (signal_number != SIGUSR1)) {
+    // The main loop will never hear of this, so rather than ignore a request
+    // to quit, we die as if the signal had not been caught.
+    signal (signal_number, SIG_DFL);
+    raise (signal_number);
+  }
+  errno = saved_errno;
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+on_signal_pipe_readable (GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+  unsigned char c;
+
+  while (read (signal_pipe[0], &c, 1) == 1) {
+    if (c == SIGUSR1) {
+      ss_stats_dump ();
+    } else {
+      // SIGINT or SIGTERM.  main dumps the stats after gtk_main returns.
+      gtk_main_quit ();
+    }
+  }
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+gboolean
+init_stats (void)
+{
+  struct sigaction action;
+
+  if (pipe (signal_pipe) != 0) {
+    return FALSE;
+  }
+  fcntl (signal_pipe[0], F_SETFL, O_NONBLOCK);
+  fcntl (signal_pipe[1], F_SETFL, O_NONBLOCK);
+
+  signal_channel = g_io_channel_unix_new (signal_pipe[0]);
+  signal_watch_id = g_io_add_watch (signal_channel, G_IO_IN,
+                  (GIOFunc) on_signal_pipe_readable, NULL);
+
+  memset (&action, 0, sizeof (action));
+  action.sa_handler = on_signal;
+  sigemptyset (&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction (SIGUSR1, &action, NULL);
+  sigaction (SIGINT,  &action, NULL);
+  sigaction (SIGTERM, &action, NULL);
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+void
+uninit_stats (void)
+{
+  signal (SIGUSR1, SIG_DFL);
+  signal (SIGINT,  SIG_DFL);
+  signal (SIGTERM, SIG_DFL);
+
+  g_source_remove (signal_watch_id);
+  signal_watch_id = 0;
+  g_io_channel_unref (signal_channel);
+  signal_channel = NULL;
+  close (signal_pipe[0]);
+  close (signal_pipe[1]);
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#ifndef SUPERSWITCHER_STATS_H
+#define SUPERSWITCHER_STATS_H
+
+#include <glib.h>
+
+#include "forward_declarations.h"
+
+// Each stage is timed from the most recent key press seen by filter_func,
+// except that:
+//  - SS_STATS_X_SERVER_TO_FILTER is how much later than usual that key press
+//    reached us (judged by its X server timestamp).
+//  - The popup shown and first expose stages are only recorded when the
+//    popup is shown for that key press (see ss_stats_begin_show), and not,
+//    for example, when it is shown over D-Bus.  If --popup-delay held the
+//    popup back, they are timed from when the delay ran out instead.
+typedef enum {
+  SS_STATS_X_SERVER_TO_FILTER,
+  SS_STATS_KEY_PRESS_TO_POPUP_SHOWN,
+  SS_STATS_KEY_PRESS_TO_FIRST_EXPOSE,
+  SS_STATS_KEY_PRESS_TO_ACTION_DONE,
+  SS_STATS_NUM_STAGES
+} SSStatsStage;
+
+// These are all no-ops unless collect_stats is TRUE.
+void   ss_stats_key_press    (guint32 x_time);
+void   ss_stats_begin_show   (gboolean after_delay);
+void   ss_stats_end_show     (void);
+void   ss_stats_mark         (SSStatsStage stage);
+void   ss_stats_dump         (void);
+
+gboolean   init_stats     (void);
+void       uninit_stats   (void);
+
+#endif
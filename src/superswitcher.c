@@ -11,7 +11,9 @@
 #include <X11/Xlib.h>
 
 #include "screen.h"
+#include "keybindings.h"
 #include "popup.h"
+#include "stats.h"
 
 #ifdef HAVE_DBUS_GLIB
 #include "dbus-object.h"
@@ -26,40 +28,203 @@
 // TODO - listen to window manager changes.
 gboolean window_manager_uses_viewports = FALSE;
 
+gboolean tab_across_workspaces = FALSE;
+
+// Whether stepping through windows (or workspaces) only moves the popup's
+// highlight, with the highlighted window (or workspace) being activated when
+// Super is released.
+gboolean switch_windows_on_release = FALSE;
+gboolean switch_workspaces_on_release = FALSE;
+
 //------------------------------------------------------------------------------
 
 static Window x_root_window = None;
 static SSScreen *screen = NULL;
 static Popup *popup = NULL;
+static gboolean popup_is_showing = FALSE;
+static gboolean persistent_popup = FALSE;
+static int popup_delay = 0;
+static guint popup_delay_source_id = 0;
 static int popup_keycode_to_free = -1;
+static int held_keycode = -1;
 static gboolean also_trigger_on_caps_lock = FALSE;
 static gboolean only_trigger_on_caps_lock = FALSE;
 static gboolean show_version_and_exit = FALSE;
 
 //------------------------------------------------------------------------------
 
+// With --persistent-popup, the popup is built once (in main) and kept up to
+// date while it is hidden, so that showing it is just mapping its window.
+// Otherwise, it is built afresh every time it is shown.
+static void
+show_popup (void)
+{
+  if (popup_delay_source_id != 0) {
+    g_source_remove (popup_delay_source_id);
+    popup_delay_source_id = 0;
+  }
+  if (popup_is_showing) {
+    return;
+  }
+  if (persistent_popup) {
+    popup_show (popup);
+  } else {
+    popup = popup_create (screen);
+  }
+  popup_is_showing = TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+static void
+hide_popup (void)
+{
+  if (!popup_is_showing) {
+    return;
+  }
+  ss_stats_end_show ();
+  if (persistent_popup) {
+    popup_hide (popup);
+  } else {
+    popup_free (popup);
+    popup = NULL;
+  }
+  popup_is_showing = FALSE;
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+on_popup_delay_timeout (gpointer data)
+{
+  popup_delay_source_id = 0;
+  ss_stats_begin_show (TRUE);
+  show_popup ();
+  return FALSE;
+}
+
+//------------------------------------------------------------------------------
+
+// With detectable autorepeat (which GDK asks XKB for), a held key sends a
+// run of KeyPresses and then one KeyRelease.  Without it, each repeat is a
+// KeyRelease immediately followed by a KeyPress with the same keycode and
+// time, so the KeyRelease is only real if no such KeyPress is queued.
+static gboolean
+is_autorepeat_release (Display *x_display, XKeyEvent *x_key_event)
+{
+  XEvent next_event;
+
+  if (XEventsQueued (x_display, QueuedAfterReading) == 0) {
+    return FALSE;
+  }
+  XPeekEvent (x_display, &next_event);
+  return (next_event.type == KeyPress) &&
+         (next_event.xkey.keycode == x_key_event->keycode) &&
+         (next_event.xkey.time == x_key_event->time);
+}
+
+//------------------------------------------------------------------------------
+
+// Whether the selection that this navigation key moves is only acted upon
+// when Super is released, rather than when the key itself is.
+static gboolean
+waits_for_super_release (XKeyEvent *x_key_event)
+{
+  const SSKeyBinding *binding;
+
+  binding = ss_keybindings_lookup (x_key_event);
+  if (binding == NULL) {
+    return FALSE;
+  }
+  switch (binding->action) {
+  case SS_ACTION_CHANGE_WORKSPACE_BY_DELTA:
+  case SS_ACTION_CHANGE_WORKSPACE:
+    return switch_workspaces_on_release;
+  case SS_ACTION_CHANGE_WINDOW_BY_DELTA:
+  case SS_ACTION_CHANGE_WINDOW_BY_MRU_ORDER:
+    return switch_windows_on_release;
+  default:
+    return FALSE;
+  }
+}
+
+//------------------------------------------------------------------------------
+
 static GdkFilterReturn
 filter_func (GdkXEvent *gdk_xevent, GdkEvent *event, gpointer data)
 {
   XEvent *x_event;
+  Display *x_display;
+  gboolean is_autorepeat;
   x_event = (XEvent *) gdk_xevent;
+  x_display = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
 
   switch (x_event->type) {
   case KeyPress:
-    if (popup == NULL && popup_keycode_to_free == -1) {
+    ss_stats_key_press (x_event->xkey.time);
+    if (!popup_is_showing && popup_keycode_to_free == -1) {
       popup_keycode_to_free = x_event->xkey.keycode;
-      popup = popup_create (screen);
+      if (popup_delay > 0) {
+        // A quick Super-Tab should not have to build, map and paint the
+        // popup, so hold off on that until Super has been held for a while.
+        // In the meantime, keep the MRU list still, as the popup would.
+        ss_screen_freeze_mru (screen);
+        popup_delay_source_id =
+          g_timeout_add (popup_delay, on_popup_delay_timeout, NULL);
+      } else {
+        ss_stats_begin_show (FALSE);
+        show_popup ();
+      }
+    } else if (popup_keycode_to_free == x_event->xkey.keycode) {
+      // Holding the trigger key down autorepeats it, which means nothing.
     } else {
-      popup_on_key_press (popup,
-                          GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
-                          &x_event->xkey);
+      // Holding Super-Right down would otherwise switch workspace some 30
+      // times a second, so the navigation keys (the first press as well as
+      // the repeats) just move the selection, and one switch is made, to
+      // wherever it ends up, when the key is released.  A different key
+      // ends the burst, unless everything waits for Super to be released.
+      is_autorepeat = (held_keycode == (int) x_event->xkey.keycode);
+      if (!is_autorepeat) {
+        if (!switch_windows_on_release && !switch_workspaces_on_release) {
+          ss_screen_commit_selection (screen, x_event->xkey.time);
+        }
+        held_keycode = x_event->xkey.keycode;
+      }
+      if (popup_is_showing ||
+          !popup_on_key_press_while_hidden (screen, x_display, &x_event->xkey)) {
+        if (!popup_is_showing) {
+          ss_stats_begin_show (FALSE);
+          show_popup ();
+        }
+        popup_on_key_press (popup, x_display, &x_event->xkey);
+      }
+      ss_stats_mark (SS_STATS_KEY_PRESS_TO_ACTION_DONE);
     }
     break;
   case KeyRelease:
+    if (is_autorepeat_release (x_display, &x_event->xkey)) {
+      break;
+    }
+    if (held_keycode == (int) x_event->xkey.keycode) {
+      held_keycode = -1;
+      if (!waits_for_super_release (&x_event->xkey)) {
+        ss_screen_commit_selection (screen, x_event->xkey.time);
+      }
+    }
     if (popup_keycode_to_free == x_event->xkey.keycode) {
       popup_keycode_to_free = -1;
-      popup_free (popup);
-      popup = NULL;
+      // Once the grab is gone, we will not see the other key's release.
+      held_keycode = -1;
+      ss_screen_commit_selection (screen, x_event->xkey.time);
+      if (popup_is_showing) {
+        hide_popup ();
+      } else {
+        if (popup_delay_source_id != 0) {
+          g_source_remove (popup_delay_source_id);
+          popup_delay_source_id = 0;
+        }
+        ss_screen_thaw_mru (screen);
+      }
     }
     break;
   default:
@@ -125,10 +290,7 @@ disable_caps_lock_default_behavior ()
 gboolean
 superswitcher_hide_popup (void *object, GError **error)
 {
-  if (popup) {
-    popup_free (popup);
-    popup = NULL;
-  }
+  hide_popup ();
   return TRUE;
 }
 
@@ -137,9 +299,7 @@ superswitcher_hide_popup (void *object, GError **error)
 gboolean
 superswitcher_show_popup (void *object, GError **error)
 {
-  if (!popup) {
-    popup = popup_create (screen);
-  }
+  show_popup ();
   return TRUE;
 }
 
@@ -148,7 +308,7 @@ superswitcher_show_popup (void *object, GError **error)
 gboolean
 superswitcher_toggle_popup (void *object, GError **error)
 {
-  if (popup) {
+  if (popup_is_showing) {
     return superswitcher_hide_popup (object, error);
   } else {
     return superswitcher_show_popup (object, error);
@@ -169,6 +329,30 @@ main (int argc, char **argv)
       &only_trigger_on_caps_lock,
       "Make only the Caps Lock key switch windows (instead of the Super key)",
       NULL },
+    { "tab-across-workspaces", 'a', 0, G_OPTION_ARG_NONE,
+      &tab_across_workspaces,
+      "Make Super-Tab cycle through the windows on every workspace (instead of just the current one)",
+      NULL },
+    { "switch-windows-on-release", 'w', 0, G_OPTION_ARG_NONE,
+      &switch_windows_on_release,
+      "Make Super-Tab, Super-Up and Super-Down only highlight a window, which is activated when Super is released",
+      NULL },
+    { "switch-workspaces-on-release", 'W', 0, G_OPTION_ARG_NONE,
+      &switch_workspaces_on_release,
+      "Make Super-Left, Super-Right and Super-F1 to F12 only highlight a workspace, which is switched to (bringing any windows along) when Super is released",
+      NULL },
+    { "persistent-popup", 'p', 0, G_OPTION_ARG_NONE,
+      &persistent_popup,
+      "Build the popup once at startup and keep it up to date, so that it shows faster (at the cost of some background work)",
+      NULL },
+    { "popup-delay", 'd', 0, G_OPTION_ARG_INT,
+      &popup_delay,
+      "Wait this many milliseconds after Super is pressed before showing the popup (Super-Tab and friends still work in the meantime)",
+      "MS" },
+    { "stats", 's', 0, G_OPTION_ARG_NONE,
+      &collect_stats,
+      "Time how long the popup takes to respond to key presses, and print a summary on SIGUSR1 and at exit",
+      NULL },
     { "version", 'v', 0, G_OPTION_ARG_NONE, &show_version_and_exit,
       "Show the version number and exit", NULL },
 #ifdef HAVE_XCOMPOSITE
@@ -213,6 +397,12 @@ main (int argc, char **argv)
   }
 #endif
 
+  if (collect_stats) {
+    collect_stats = init_stats ();
+  }
+
+  ss_keybindings_init (GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()));
+
   root = gdk_get_default_root_window ();
   x_root_window = GDK_WINDOW_XWINDOW (root);
 
@@ -229,9 +419,17 @@ main (int argc, char **argv)
   screen = ss_screen_new (wnck_screen_get_default (),
                           GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
                           x_root_window);
+  if (persistent_popup) {
+    popup = popup_new (screen);
+  }
 
   gtk_main ();
 
+  if (collect_stats) {
+    ss_stats_dump ();
+    uninit_stats ();
+  }
+
 #ifdef HAVE_XCOMPOSITE
   if (show_window_thumbnails) {
     uninit_composite ();
@@ -114,7 +114,7 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
   GdkGC *gc;
   XTransform transform;
   double scale;
-  int wx, wy, ww, wh;
+  int ww, wh;
   int frame_left, frame_right, frame_top, frame_bottom;
   int thumbnail_width, thumbnail_height;
   int offset_x, offset_y;
@@ -133,7 +133,8 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
       window->workspace->screen->xinerama, window,
       &frame_left, &frame_right, &frame_top, &frame_bottom);
 
-  wnck_window_get_geometry (window->wnck_window, &wx, &wy, &ww, &wh);
+  ww = window->geometry.width;
+  wh = window->geometry.height;
 
   scale = ww > wh ? ww : wh;
   scale /= (double) THUMBNAIL_SIZE;
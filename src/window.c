@@ -23,33 +23,22 @@ ss_window_update_label_max_width_chars (SSWindow *window)
 
 //------------------------------------------------------------------------------
 
+// Sets the label's weight and style together, since each call to
+// gtk_label_set_attributes replaces all of the previous attributes.
 static void
-ss_window_set_bold (SSWindow *window, gboolean bold)
+ss_window_set_bold_and_italic (SSWindow *window, gboolean bold, gboolean italic)
 {
   PangoAttribute *pa;
   PangoAttrList *pal;
 
+  pal = pango_attr_list_new ();
   pa = pango_attr_weight_new (bold ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL);
   pa->start_index = 0;
   pa->end_index = G_MAXINT;
-  pal = pango_attr_list_new ();
   pango_attr_list_insert (pal, pa);
-  gtk_label_set_attributes (GTK_LABEL (window->label), pal);
-  pango_attr_list_unref (pal);
-}
-
-//------------------------------------------------------------------------------
-
-static void
-ss_window_set_italic (SSWindow *window, gboolean italic)
-{
-  PangoAttribute *pa;
-  PangoAttrList *pal;
-
   pa = pango_attr_style_new (italic ? PANGO_STYLE_ITALIC : PANGO_STYLE_NORMAL);
   pa->start_index = 0;
   pa->end_index = G_MAXINT;
-  pal = pango_attr_list_new ();
   pango_attr_list_insert (pal, pa);
   gtk_label_set_attributes (GTK_LABEL (window->label), pal);
   pango_attr_list_unref (pal);
@@ -57,7 +46,7 @@ ss_window_set_italic (SSWindow *window, gboolean italic)
 
 //------------------------------------------------------------------------------
 
-void
+static void
 ss_window_set_selected (SSWindow *window, gboolean selected)
 {
   gtk_widget_set_state (window->label,
@@ -72,6 +61,7 @@ ss_window_set_sensitive (SSWindow *window, gboolean sensitive)
   gtk_widget_set_sensitive (GTK_WIDGET (window->image), sensitive);
   gtk_widget_set_sensitive (GTK_WIDGET (window->label), sensitive);
   window->sensitive = sensitive;
+  ss_screen_update_window_table_sensitive (window->screen, window);
 }
 
 //------------------------------------------------------------------------------
@@ -108,7 +98,7 @@ ss_window_activate_window (SSWindow *window, guint32 time,
   wnck_window_activate (window->wnck_window, time);
   if (also_warp_pointer_if_necessary &&
       window->screen->pointer_needs_recentering_on_focus_change) {
-    wnck_window_get_geometry (window->wnck_window, &r.x, &r.y, &r.width, &r.height);
+    r = window->geometry;
     XWarpPointer (window->screen->xinerama->x_display,
                   None,
                   window->screen->xinerama->x_root_window,
@@ -133,7 +123,8 @@ ss_window_update_for_new_workspace (SSWindow *window, SSWorkspace *new_workspace
     ss_workspace_add_window (new_workspace, window);
   }
   window->new_window_index = -1;
-  gtk_widget_queue_draw (gtk_widget_get_toplevel (window->widget));
+  ss_screen_check_consistency (window->screen);
+  ss_screen_queue_redraw (window->screen);
 }
 
 
@@ -142,7 +133,7 @@ ss_window_update_for_new_workspace (SSWindow *window, SSWorkspace *new_workspace
 void
 ss_window_move_to_workspace (SSWindow *window, SSWorkspace *workspace)
 {
-  int old_x, old_y, old_w, old_h;
+  int old_x;
   int frame_left, frame_right, frame_top, frame_bottom;
   int workspace_delta;
   int new_x;
@@ -154,7 +145,7 @@ ss_window_move_to_workspace (SSWindow *window, SSWorkspace *workspace)
     return;
   }
   if (window_manager_uses_viewports) {
-    wnck_window_get_geometry (window->wnck_window, &old_x, &old_y, &old_w, &old_h);
+    old_x = window->geometry.x;
     workspace_delta = workspace->viewport - window->workspace->viewport;
     ss_xinerama_get_frame_extents (window->screen->xinerama, window,
       &frame_left, &frame_right, &frame_top, &frame_bottom);
@@ -210,12 +201,12 @@ on_button_release_event (GtkWidget *widget, GdkEventButton *event, gpointer data
         // to directly after itself should be a no-op,
         // just like moving a window to directly
         // before itself.  The former case is like
-        // moving a window with g_list_index == 2
+        // moving a window with index == 2
         // to a new position of new_window_index == 3,
         // which needs to be adjusted by -1.
         if (dnd->new_window_index >
-          g_list_index (
-          dnd->drag_start_workspace->windows,
+          ss_workspace_get_window_index (
+          dnd->drag_start_workspace,
           dnd->drag_start_window)) {
 
           dnd->new_window_index -= 1;
@@ -249,15 +240,31 @@ on_motion_notify_event (GtkWidget *widget, GdkEventMotion *event, gpointer data)
 
 //------------------------------------------------------------------------------
 
+void
+ss_window_update_geometry (SSWindow *window)
+{
+  GdkRectangle *r;
+  r = &window->geometry;
+  wnck_window_get_geometry (window->wnck_window, &r->x, &r->y, &r->width, &r->height);
+  window->workspace_id = ss_screen_get_workspace_id_for_geometry (
+    window->screen, wnck_window_get_workspace (window->wnck_window), r);
+  window->xinerama_screen = ss_xinerama_get_screen_for_rectangle (
+    window->screen->xinerama, r->x, r->y, r->width, r->height);
+}
+
+//------------------------------------------------------------------------------
+
 static void
 on_geometry_changed (WnckWindow *wnck_window, gpointer data)
 {
   SSWindow *window;
   window = (SSWindow *) data;
-  gtk_widget_queue_draw (gtk_widget_get_toplevel (window->widget));
-  if (window_manager_uses_viewports) {
+  ss_window_update_geometry (window);
+  ss_screen_queue_redraw (window->screen);
+  if (window_manager_uses_viewports &&
+      !ss_screen_on_bulk_moved_window_changed (window->screen, window)) {
     ss_window_update_for_new_workspace (window,
-      ss_screen_get_workspace_for_wnck_window (window->screen, wnck_window));
+      ss_screen_get_nth_workspace (window->screen, window->workspace_id));
   }
 }
 
@@ -268,29 +275,20 @@ on_icon_changed (WnckWindow *wnck_window, gpointer data)
 {
   SSWindow *window;
   window = (SSWindow *) data;
-  gtk_image_set_from_pixbuf (GTK_IMAGE(window->image),
-    wnck_window_get_mini_icon (wnck_window));
+  ss_screen_queue_window_update (window->screen, window, SS_WINDOW_DIRTY_ICON);
 }
 
-
 //------------------------------------------------------------------------------
 
 static void
 on_name_changed (WnckWindow *wnck_window, gpointer data)
 {
   SSWindow *window;
-  const char *name;
   window = (SSWindow *) data;
-  name = wnck_window_get_name (wnck_window);
-  gtk_label_set_text (GTK_LABEL (window->label), name);
-#ifdef HAVE_GTK_2_11
-  gtk_widget_set_tooltip_text (window->widget, name);
-#else
-  if (window->workspace) {
-    gtk_tooltips_set_tip (GTK_TOOLTIPS (window->screen->tooltips), window->widget, name, "");
-  }
-#endif
-  gtk_widget_queue_draw (gtk_widget_get_toplevel (window->widget));
+  // The table's copy of the title is what searches match against, so it is
+  // kept current even while the label's update is queued.
+  ss_screen_update_window_table_title (window->screen, window);
+  ss_screen_queue_window_update (window->screen, window, SS_WINDOW_DIRTY_NAME);
 }
 
 //------------------------------------------------------------------------------
@@ -300,18 +298,58 @@ on_state_changed (WnckWindow *wnck_window, WnckWindowState changed_mask, WnckWin
 {
   SSWindow *window;
   window = (SSWindow *) data;
+  if (changed_mask & (WNCK_WINDOW_STATE_DEMANDS_ATTENTION |
 #ifdef HAVE_WNCK_2_12
-  if (changed_mask & (WNCK_WINDOW_STATE_DEMANDS_ATTENTION | WNCK_WINDOW_STATE_URGENT)) {
-    ss_window_set_bold (window, wnck_window_needs_attention (wnck_window));
+                      WNCK_WINDOW_STATE_URGENT |
+#endif
+                      WNCK_WINDOW_STATE_MINIMIZED)) {
+    ss_screen_queue_window_update (window->screen, window, SS_WINDOW_DIRTY_STATE);
   }
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_window_flush_updates (SSWindow *window)
+{
+  WnckWindow *wnck_window;
+  const char *name;
+  gboolean needs_attention;
+
+  wnck_window = window->wnck_window;
+  if (window->dirty_flags & SS_WINDOW_DIRTY_NAME) {
+    name = wnck_window_get_name (wnck_window);
+    gtk_label_set_text (GTK_LABEL (window->label), name);
+#ifdef HAVE_GTK_2_11
+    gtk_widget_set_tooltip_text (window->widget, name);
 #else
-  if (changed_mask & (WNCK_WINDOW_STATE_DEMANDS_ATTENTION)) {
-    ss_window_set_bold (window, wnck_window_demands_attention (wnck_window));
+    if (window->workspace) {
+      gtk_tooltips_set_tip (GTK_TOOLTIPS (window->screen->tooltips), window->widget, name, "");
+    }
+#endif
   }
+
+  if (window->dirty_flags & SS_WINDOW_DIRTY_ICON) {
+    gtk_image_set_from_pixbuf (GTK_IMAGE(window->image),
+      wnck_window_get_mini_icon (wnck_window));
+  }
+
+  if (window->dirty_flags & SS_WINDOW_DIRTY_STATE) {
+#ifdef HAVE_WNCK_2_12
+    needs_attention = wnck_window_needs_attention (wnck_window);
+#else
+    needs_attention = wnck_window_demands_attention (wnck_window);
 #endif
-  if (changed_mask & WNCK_WINDOW_STATE_MINIMIZED) {
-    ss_window_set_italic (window, wnck_window_is_minimized (wnck_window));
+    ss_window_set_bold_and_italic (window, needs_attention,
+      wnck_window_is_minimized (wnck_window));
+  }
+
+  if (window->dirty_flags & SS_WINDOW_DIRTY_SELECTED) {
+    ss_window_set_selected (window,
+      window == ss_screen_get_highlighted_window (window->screen));
   }
+
+  window->dirty_flags = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -320,22 +358,14 @@ static void
 on_workspace_changed (WnckWindow *wnck_window, gpointer data)
 {
   SSWindow *window;
-  SSWorkspace *old_workspace;
-  SSWorkspace *new_workspace;
-  WnckWorkspace *new_wnck_workspace;
-  int new_workspace_id;
 
   window = (SSWindow *) data;
-  old_workspace = window->workspace;
-  new_wnck_workspace = wnck_window_get_workspace (wnck_window);
-  if (new_wnck_workspace) {
-    new_workspace_id = wnck_workspace_get_number (new_wnck_workspace);
-    new_workspace = ss_screen_get_nth_workspace (window->screen, new_workspace_id);
-  } else {
-    new_workspace_id = -1;
-    new_workspace = NULL;
+  ss_window_update_geometry (window);
+  if (ss_screen_on_bulk_moved_window_changed (window->screen, window)) {
+    return;
   }
-  ss_window_update_for_new_workspace (window, new_workspace);
+  ss_window_update_for_new_workspace (window,
+    ss_screen_get_nth_workspace (window->screen, window->workspace_id));
 }
 
 //------------------------------------------------------------------------------
@@ -346,7 +376,7 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
   SSWindow *window;
   window = (SSWindow *) data;
 
-  if (window == window->screen->active_window) {
+  if (window == ss_screen_get_highlighted_window (window->screen)) {
     gtk_paint_box (widget->style,
       widget->window,
       GTK_STATE_NORMAL,
@@ -380,12 +410,6 @@ ss_window_new (SSWorkspace *workspace, WnckWindow *wnck_window)
 
   eventbox = gtk_event_box_new ();
   gtk_event_box_set_visible_window (GTK_EVENT_BOX (eventbox), FALSE);
-#ifdef HAVE_GTK_2_11
-  gtk_widget_set_tooltip_text (eventbox, wnck_window_get_name (wnck_window));
-#else
-  gtk_tooltips_set_tip (GTK_TOOLTIPS (workspace->screen->tooltips),
-    eventbox, wnck_window_get_name (wnck_window), "");
-#endif
 
   hbox = gtk_hbox_new (FALSE, 3);
   gtk_container_add (GTK_CONTAINER (eventbox), hbox);
@@ -400,14 +424,13 @@ ss_window_new (SSWorkspace *workspace, WnckWindow *wnck_window)
   } else {
 #endif
     image = gtk_image_new ();
-    gtk_image_set_from_pixbuf (GTK_IMAGE(image), wnck_window_get_mini_icon (wnck_window));
 #ifdef HAVE_XCOMPOSITE
     thumbnailer = NULL;
   }
 #endif
   gtk_box_pack_start (GTK_BOX (hbox), image, FALSE, FALSE, 0);
 
-  label = gtk_label_new (wnck_window_get_name (wnck_window));
+  label = gtk_label_new (NULL);
   gtk_box_pack_start (GTK_BOX (hbox), label, TRUE, TRUE, 0);
   gtk_label_set_max_width_chars (GTK_LABEL (label), workspace->screen->label_max_width_chars);
   gtk_label_set_ellipsize (GTK_LABEL (label), PANGO_ELLIPSIZE_MIDDLE);
@@ -426,7 +449,19 @@ ss_window_new (SSWorkspace *workspace, WnckWindow *wnck_window)
   w->thumbnailer = thumbnailer;
 #endif
   w->sensitive = TRUE;
+  // The label's text, tooltip and style, and the icon, are all filled in
+  // by the first ss_screen_flush_updates, like any later change to them.
+  w->dirty_flags = 0;
+  ss_screen_queue_window_update (w->screen, w,
+#ifdef HAVE_XCOMPOSITE
+    show_window_thumbnails ? (SS_WINDOW_DIRTY_NAME | SS_WINDOW_DIRTY_STATE) :
+#endif
+    (SS_WINDOW_DIRTY_NAME | SS_WINDOW_DIRTY_ICON | SS_WINDOW_DIRTY_STATE));
+  w->table_index = -1;
+  w->is_bulk_moving = FALSE;
   w->new_window_index = -1;
+  w->frame_extents_are_valid = FALSE;
+  ss_window_update_geometry (w);
   w->signal_id_geometry_changed =
     g_signal_connect (G_OBJECT (wnck_window), "geometry-changed",
     (GCallback) on_geometry_changed,
@@ -463,15 +498,6 @@ ss_window_new (SSWorkspace *workspace, WnckWindow *wnck_window)
     (GCallback) on_motion_notify_event,
     w);
   g_object_ref (w->widget);
-#ifdef HAVE_WNCK_2_12
-  if (wnck_window_needs_attention (wnck_window)) {
-    ss_window_set_bold (w, TRUE);
-  }
-#else
-  if (wnck_window_demands_attention (wnck_window)) {
-    ss_window_set_bold (w, TRUE);
-  }
-#endif
   return w;
 }
 
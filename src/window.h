@@ -30,18 +30,60 @@ struct _SSWindow {
 
   gboolean   sensitive;
 
+  // Which parts of the widget are out of date, as SS_WINDOW_DIRTY_* bits.
+  // They are brought up to date by ss_screen_flush_updates.
+  guint   dirty_flags;
+
+  // This window's row in the screen's window_table, if it is on a workspace.
+  int   table_index;
+
+  // This window's link in the screen's mru_windows.
+  GList *   mru_link;
+
+  // Whether this window is in the screen's bulk_moved_windows, which it must
+  // be no more than once, even if a second bulk move starts before the first
+  // has finished.
+  gboolean   is_bulk_moving;
+
+  // A snapshot of the window's geometry (in root window co-ordinates), of
+  // the workspace (or, with viewports, the viewport) that it is on, and of the
+  // Xinerama screen that it is mostly on.  See ss_window_update_geometry.
+  GdkRectangle   geometry;
+  int            workspace_id;
+  int            xinerama_screen;
+
+  // The window's _NET_FRAME_EXTENTS, cached until a PropertyNotify says that
+  // they have changed.  See ss_xinerama_get_frame_extents.
+  gboolean   frame_extents_are_valid;
+  int        frame_left;
+  int        frame_right;
+  int        frame_top;
+  int        frame_bottom;
+
   int   new_window_index;
 };
 
+#define SS_WINDOW_DIRTY_NAME       (1 << 0)
+#define SS_WINDOW_DIRTY_ICON       (1 << 1)
+#define SS_WINDOW_DIRTY_STATE      (1 << 2)
+#define SS_WINDOW_DIRTY_SELECTED   (1 << 3)
+// The widget is not (yet) in its place in its workspace's column.  See
+// ss_workspace_update_window_widgets.
+#define SS_WINDOW_DIRTY_PARENT     (1 << 4)
+// The widget is in its workspace's column, but not where it was re-ordered
+// to.  See ss_workspace_update_window_widget_position.
+#define SS_WINDOW_DIRTY_POSITION   (1 << 5)
+
 SSWindow *   ss_window_new    (SSWorkspace *workspace, WnckWindow *wnck_window);
 void         ss_window_free   (SSWindow *window);
 
 void   ss_window_activate_window                 (SSWindow *window, guint32 time, gboolean also_warp_pointer_if_necessary);
 void   ss_window_activate_workspace_and_window   (SSWindow *window, guint32 time, gboolean also_warp_pointer_if_necessary);
+void   ss_window_flush_updates                   (SSWindow *window);
 void   ss_window_move_to_workspace               (SSWindow *window, SSWorkspace *workspace);
-void   ss_window_set_selected                    (SSWindow *window, gboolean selected);
 void   ss_window_set_sensitive                   (SSWindow *window, gboolean sensitive);
 void   ss_window_update_for_new_workspace        (SSWindow *window, SSWorkspace *new_workspace);
+void   ss_window_update_geometry                 (SSWindow *window);
 void   ss_window_update_label_max_width_chars    (SSWindow *window);
 
 #endif
@@ -16,36 +16,13 @@
 
 //------------------------------------------------------------------------------
 
-static void
-workspace_remove_window_widgets (SSWorkspace *workspace)
-{
-  GList *children;
-  GList *i;
-  GtkWidget *child;
-  GtkContainer *container;
-
-  container = GTK_CONTAINER (workspace->window_container);
-  children = gtk_container_get_children (container);
-  for (i = children; i; i = i->next) {
-    child = GTK_WIDGET (i->data);
-    gtk_container_remove (container, child);
-  }
-  g_list_free (children);
-}
-
-//------------------------------------------------------------------------------
-
-static void
-workspace_add_window_widgets (SSWorkspace *workspace)
+int
+ss_workspace_get_window_index (SSWorkspace *workspace, SSWindow *window)
 {
-  GList *i;
-  SSWindow *window;
-
-  for (i = workspace->windows; i; i = i->next) {
-    window = (SSWindow *) i->data;
-    gtk_box_pack_start (GTK_BOX (workspace->window_container),
-      window->widget, FALSE, FALSE, 0);
+  if ((window == NULL) || (window->workspace != workspace)) {
+    return -1;
   }
+  return window->table_index - workspace->first_table_index;
 }
 
 //------------------------------------------------------------------------------
@@ -56,9 +33,10 @@ ss_workspace_add_window (SSWorkspace *workspace, SSWindow *window)
   if (window == NULL) {
     return;
   }
-  workspace->windows = g_list_append (workspace->windows, window);
-  gtk_box_pack_start (GTK_BOX (workspace->window_container),
-    window->widget, TRUE, TRUE, 0);
+  g_ptr_array_add (workspace->windows, window);
+  workspace->screen->workspace_stacking_is_dirty = TRUE;
+  ss_screen_insert_window_table_row (workspace->screen, workspace, window);
+  ss_screen_queue_window_update (workspace->screen, window, SS_WINDOW_DIRTY_PARENT);
 
   if (window->new_window_index != -1) {
     ss_workspace_reorder_window (workspace, window,
@@ -74,8 +52,10 @@ ss_workspace_remove_window (SSWorkspace *workspace, SSWindow *window)
   if (window == NULL) {
     return;
   }
-  workspace->windows = g_list_remove (workspace->windows, window);
-  gtk_container_remove (GTK_CONTAINER (workspace->window_container), window->widget);
+  ss_screen_remove_window_table_row (workspace->screen, workspace, window);
+  g_ptr_array_remove (workspace->windows, window);
+  workspace->screen->workspace_stacking_is_dirty = TRUE;
+  ss_screen_queue_window_update (workspace->screen, window, SS_WINDOW_DIRTY_PARENT);
 }
 
 //------------------------------------------------------------------------------
@@ -83,21 +63,81 @@ ss_workspace_remove_window (SSWorkspace *workspace, SSWindow *window)
 void
 ss_workspace_reorder_window (SSWorkspace *workspace, SSWindow *window, int new_index)
 {
-  int n;
+  int old_index;
+  int i;
   if (window == NULL) {
     return;
   }
-  n = g_list_length (workspace->windows);
+  old_index = ss_workspace_get_window_index (workspace, window);
+  if (old_index == -1) {
+    return;
+  }
   if (new_index < 0) {
     new_index = 0;
   }
-  if (new_index > n) {
-    new_index = n;
+  if (new_index >= (int) workspace->windows->len) {
+    new_index = workspace->windows->len - 1;
+  }
+  if (new_index == old_index) {
+    return;
   }
-  workspace->windows = g_list_remove (workspace->windows, window);
-  workspace->windows = g_list_insert (workspace->windows, window, new_index);
-  workspace_remove_window_widgets (workspace);
-  workspace_add_window_widgets (workspace);
+
+  // Shuffle along only those windows in between the old and new index.  The
+  // one child widget is moved by the next ss_screen_flush_updates.
+  if (old_index < new_index) {
+    for (i = old_index; i < new_index; i++) {
+      workspace->windows->pdata[i] = workspace->windows->pdata[i + 1];
+    }
+  } else {
+    for (i = old_index; i > new_index; i--) {
+      workspace->windows->pdata[i] = workspace->windows->pdata[i - 1];
+    }
+  }
+  workspace->windows->pdata[new_index] = window;
+  ss_screen_move_window_table_row (workspace->screen, workspace,
+    old_index, new_index);
+  ss_screen_queue_window_update (workspace->screen, window, SS_WINDOW_DIRTY_POSITION);
+}
+
+//------------------------------------------------------------------------------
+
+// Puts the widgets of this workspace's windows into its column, in order,
+// taking them out of whichever column they were in before.  Windows that
+// come, go or change workspace only mark themselves SS_WINDOW_DIRTY_PARENT,
+// and this is left to ss_screen_flush_updates, so that while the popup is
+// hidden, they cost no widget work at all.
+void
+ss_workspace_update_window_widgets (SSWorkspace *workspace)
+{
+  SSWindow *window;
+  GtkWidget *parent;
+  guint i;
+
+  for (i = 0; i < workspace->windows->len; i++) {
+    window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
+    parent = window->widget->parent;
+    if (parent != workspace->window_container) {
+      if (parent != NULL) {
+        gtk_container_remove (GTK_CONTAINER (parent), window->widget);
+      }
+      gtk_box_pack_start (GTK_BOX (workspace->window_container),
+        window->widget, TRUE, TRUE, 0);
+      gtk_widget_show_all (window->widget);
+    }
+    gtk_box_reorder_child (GTK_BOX (workspace->window_container),
+      window->widget, i);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Moves just the one window's widget to its place in the column, which is
+// all that re-ordering a single window (already in this column) needs.
+void
+ss_workspace_update_window_widget_position (SSWorkspace *workspace, SSWindow *window)
+{
+  gtk_box_reorder_child (GTK_BOX (workspace->window_container),
+    window->widget, ss_workspace_get_window_index (workspace, window));
 }
 
 //------------------------------------------------------------------------------
@@ -153,8 +193,6 @@ on_button_release_event (GtkWidget *widget, GdkEventButton *event, gpointer data
   SSDragAndDrop *dnd;
   gboolean shifted;
   gboolean ctrled;
-  GList *i;
-  SSWindow *window;
 
   workspace = (SSWorkspace *) data;
   screen = workspace->screen;
@@ -167,13 +205,7 @@ on_button_release_event (GtkWidget *widget, GdkEventButton *event, gpointer data
     if (dnd->drag_workspace != NULL) {
       // This simple if clause is to avoid unnecessary work.
       if (dnd->drag_workspace != workspace) {
-        for (i = workspace->windows; i; i = i->next) {
-          // TODO - something weird is going on when dragging a workspace with
-          // multiple windows - only the first one is being moved. Perhaps we're
-          // modifying the list whilst iterating over it?
-          window = (SSWindow *) i->data;
-          ss_window_move_to_workspace (window, dnd->drag_workspace);
-        }
+        ss_screen_move_windows (screen, workspace, dnd->drag_workspace);
       }
       if (window_manager_uses_viewports) {
         wnck_screen_move_viewport (screen->wnck_screen, screen->screen_width * dnd->drag_workspace->viewport, 0);
@@ -238,8 +270,9 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
   double width_ratio, height_ratio;
   int x, y, w, h;
   int viewport_x;
-  GList *i;
-  SSWindow *active_window;
+  guint i;
+  SSWindow *window;
+  SSWindow *highlighted_window;
   WnckWindow *wnck_window;
   int state;
   GdkRectangle r;
@@ -247,14 +280,15 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
   workspace = (SSWorkspace *) data;
   screen_width  = workspace->screen->screen_width;
   screen_height = workspace->screen->screen_height;
-  active_window = workspace->screen->active_window;
+  highlighted_window = ss_screen_get_highlighted_window (workspace->screen);
 
   x = widget->allocation.x;
   y = widget->allocation.y;
   w = widget->allocation.width;
   h = widget->allocation.height;
 
-  state = (workspace == workspace->screen->active_workspace) ? GTK_STATE_SELECTED : GTK_STATE_NORMAL;
+  state = (workspace == ss_screen_get_highlighted_workspace (workspace->screen))
+    ? GTK_STATE_SELECTED : GTK_STATE_NORMAL;
   gdk_draw_rectangle (widget->window,
     widget->style->dark_gc[state], TRUE,
     1, 1, w-2, h-2);
@@ -270,21 +304,16 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
     viewport_x = wnck_workspace_get_viewport_x (workspace->wnck_workspace);
   }
 
-  for (i = workspace->screen->wnck_windows_in_stacking_order; i; i = i->next) {
-    wnck_window = (WnckWindow *) i->data;
-    if (wnck_window_get_workspace (wnck_window) != workspace->wnck_workspace) {
-      continue;
-    }
+  ss_screen_update_workspace_stacking (workspace->screen);
+  for (i = 0; i < workspace->windows_in_stacking_order->len; i++) {
+    window = (SSWindow *) g_ptr_array_index (workspace->windows_in_stacking_order, i);
+    wnck_window = window->wnck_window;
     if (wnck_window_is_minimized (wnck_window)) {
       continue;
     }
 
-    state = GTK_STATE_ACTIVE;
-    if ((active_window != NULL) &&
-      ((wnck_window_get_xid (wnck_window) == wnck_window_get_xid (active_window->wnck_window)))) {
-      state = GTK_STATE_SELECTED;
-    }
-    wnck_window_get_geometry (wnck_window, &r.x, &r.y, &r.width, &r.height);
+    state = (window == highlighted_window) ? GTK_STATE_SELECTED : GTK_STATE_ACTIVE;
+    r = window->geometry;
     if (window_manager_uses_viewports) {
       r.x += viewport_x - (workspace->viewport * workspace->screen->screen_width);
     }
@@ -318,19 +347,18 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
 int
 ss_workspace_find_index_near_point (SSWorkspace *workspace, int x, int y)
 {
-  GList *i;
   int index;
   int n;
   SSWindow *window;
   GtkAllocation *a;
 
-  n = g_list_length (workspace->windows);
+  n = workspace->windows->len;
   if (n == 0) {
     return -1;
   }
 
-  for (i = workspace->windows, index = 0; i; i = i->next, index++) {
-    window = (SSWindow *) i->data;
+  for (index = 0; index < n; index++) {
+    window = (SSWindow *) g_ptr_array_index (workspace->windows, index);
     a = &window->widget->allocation;
     if (y < (a->y + (a->height + WINDOW_ROW_SPACING) / 2)) {
       return index;
@@ -383,7 +411,8 @@ ss_workspace_new (SSScreen *screen, WnckWorkspace *wnck_workspace, int viewport)
   w->header = header;
   w->window_container = box_2;
   w->title = "";
-  w->windows = NULL;
+  w->windows = g_ptr_array_new ();
+  w->windows_in_stacking_order = g_ptr_array_new ();
   g_signal_connect (G_OBJECT (header), "expose-event",
     (GCallback) on_expose_event,
     w);
@@ -408,10 +437,23 @@ ss_workspace_new (SSScreen *screen, WnckWorkspace *wnck_workspace, int viewport)
 void
 ss_workspace_free (SSWorkspace *workspace)
 {
+  GList *children;
+  GList *i;
+
   if (workspace == NULL) {
     return;
   }
-  g_list_free (workspace->windows);
+  // The widgets of windows that have left this workspace may not have been
+  // moved yet, and must not be destroyed along with it.
+  children = gtk_container_get_children (GTK_CONTAINER (workspace->window_container));
+  for (i = children; i; i = i->next) {
+    gtk_container_remove (GTK_CONTAINER (workspace->window_container),
+      GTK_WIDGET (i->data));
+  }
+  g_list_free (children);
+
+  g_ptr_array_free (workspace->windows, TRUE);
+  g_ptr_array_free (workspace->windows_in_stacking_order, TRUE);
   g_object_unref (workspace->widget);
   g_free (workspace);
 }
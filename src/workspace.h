@@ -19,7 +19,14 @@ struct _SSWorkspace {
   GtkWidget *   window_container;
   char *        title;
 
-  GList *   windows;
+  GPtrArray *   windows;
+
+  // The row in the screen's window_table of this workspace's first window.
+  int   first_table_index;
+
+  // This workspace's windows, bottom-to-top.  See
+  // ss_screen_update_workspace_stacking.
+  GPtrArray *   windows_in_stacking_order;
 };
 
 SSWorkspace *   ss_workspace_new    (SSScreen *screen, WnckWorkspace *wnck_workspace, int viewport);
@@ -28,6 +35,9 @@ void            ss_workspace_free   (SSWorkspace *workspace);
 void   ss_workspace_add_window       (SSWorkspace *workspace, SSWindow *window);
 void   ss_workspace_remove_window    (SSWorkspace *workspace, SSWindow *window);
 void   ss_workspace_reorder_window   (SSWorkspace *workspace, SSWindow *window, int new_index);
+int    ss_workspace_get_window_index (SSWorkspace *workspace, SSWindow *window);
+void   ss_workspace_update_window_widgets (SSWorkspace *workspace);
+void   ss_workspace_update_window_widget_position (SSWorkspace *workspace, SSWindow *window);
 
 int   ss_workspace_find_index_near_point (SSWorkspace *workspace, int x, int y);
 
@@ -11,6 +11,12 @@
 #include <X11/extensions/Xinerama.h>
 #endif
 
+#ifdef HAVE_XCB
+#include <stdlib.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+#endif
+
 #include "window.h"
 
 //------------------------------------------------------------------------------
@@ -69,16 +75,15 @@ ss_xinerama_new (Display *x_display, Window x_root_window)
   xinerama->num_screens = num_screens;
   xinerama->screens = screens;
   xinerama->minimum_width = minimum_width;
-  xinerama->net_frame_extents_atom = XInternAtom (x_display, "_NET_FRAME_EXTENTS", True);
+  xinerama->net_frame_extents_atom = XInternAtom (x_display, "_NET_FRAME_EXTENTS", False);
   return xinerama;
 }
 
 //------------------------------------------------------------------------------
 
-static int
-get_best_screen (SSXinerama *xinerama, SSWindow *window)
+int
+ss_xinerama_get_screen_for_rectangle (SSXinerama *xinerama, int x, int y, int width, int height)
 {
-  GdkRectangle r;
   SSXineramaScreen *xs;
   int i;
   int rightmost_left;
@@ -93,14 +98,13 @@ get_best_screen (SSXinerama *xinerama, SSWindow *window)
   best_overlapping_area = 0;
   best_screen = 0;
 
-  // first, find out which Xinerama screen the window is most on
-  wnck_window_get_geometry (window->wnck_window, &r.x, &r.y, &r.width, &r.height);
+  // find out which Xinerama screen the rectangle is most on
   for (i = 0; i < xinerama->num_screens; i++) {
     xs = &xinerama->screens[i];
-    rightmost_left = MAX (xs->x, r.x);
-    leftmost_right = MIN (xs->x + xs->width, r.x + r.width);
-    bottommost_top = MAX (xs->y, r.y);
-    topmost_bottom = MIN (xs->y + xs->height, r.y + r.height);
+    rightmost_left = MAX (xs->x, x);
+    leftmost_right = MIN (xs->x + xs->width, x + width);
+    bottommost_top = MAX (xs->y, y);
+    topmost_bottom = MIN (xs->y + xs->height, y + height);
 
     dx = leftmost_right - rightmost_left;
     dy = topmost_bottom - bottommost_top;
@@ -121,6 +125,90 @@ get_best_screen (SSXinerama *xinerama, SSWindow *window)
 
 //------------------------------------------------------------------------------
 
+#ifdef HAVE_XCB
+static void
+get_frame_rectangles_xcb (SSXinerama *xinerama, SSWindow **windows,
+                          int num_windows, GdkRectangle *out_rectangles)
+{
+  xcb_connection_t *c;
+  xcb_window_t x_window;
+  xcb_get_geometry_cookie_t *geometry_cookies;
+  xcb_translate_coordinates_cookie_t *translate_cookies;
+  xcb_get_property_cookie_t *property_cookies;
+  xcb_get_geometry_reply_t *geometry;
+  xcb_translate_coordinates_reply_t *translate;
+  xcb_get_property_reply_t *property;
+  uint32_t *extents;
+  SSWindow *window;
+  GdkRectangle *r;
+  int i;
+
+  c = XGetXCBConnection (xinerama->x_display);
+  geometry_cookies  = g_new (xcb_get_geometry_cookie_t, num_windows);
+  translate_cookies = g_new (xcb_translate_coordinates_cookie_t, num_windows);
+  property_cookies  = g_new (xcb_get_property_cookie_t, num_windows);
+
+  // Send every request before waiting on any reply, so that the whole batch
+  // costs one round trip, rather than up to three per window.
+  for (i = 0; i < num_windows; i++) {
+    window = windows[i];
+    x_window = wnck_window_get_xid (window->wnck_window);
+    geometry_cookies[i] = xcb_get_geometry (c, x_window);
+    translate_cookies[i] = xcb_translate_coordinates (
+      c, x_window, xinerama->x_root_window, 0, 0);
+    if (!window->frame_extents_are_valid) {
+      property_cookies[i] = xcb_get_property (c, 0, x_window,
+        xinerama->net_frame_extents_atom, XCB_GET_PROPERTY_TYPE_ANY, 0, 4);
+    }
+  }
+  xcb_flush (c);
+
+  for (i = 0; i < num_windows; i++) {
+    window = windows[i];
+    r = &out_rectangles[i];
+    geometry = xcb_get_geometry_reply (c, geometry_cookies[i], NULL);
+    translate = xcb_translate_coordinates_reply (c, translate_cookies[i], NULL);
+
+    // This mirrors get_frame_extents_uncached, except that on the wire (unlike
+    // in Xlib) the 32-bit values really are 32 bits wide.
+    if (!window->frame_extents_are_valid) {
+      property = xcb_get_property_reply (c, property_cookies[i], NULL);
+      window->frame_left = window->frame_right = 0;
+      window->frame_top = window->frame_bottom = 0;
+      if ((property != NULL) && (property->format == 32) &&
+          (property->value_len == 4) && (property->bytes_after == 0)) {
+        extents = (uint32_t *) xcb_get_property_value (property);
+        window->frame_left   = (int) extents[0];
+        window->frame_right  = (int) extents[1];
+        window->frame_top    = (int) extents[2];
+        window->frame_bottom = (int) extents[3];
+      }
+      free (property);
+      window->frame_extents_are_valid = TRUE;
+    }
+
+    if ((geometry != NULL) && (translate != NULL)) {
+      r->x = translate->dst_x - window->frame_left;
+      r->y = translate->dst_y - window->frame_top;
+      r->width  = geometry->width  + window->frame_left + window->frame_right;
+      r->height = geometry->height + window->frame_top  + window->frame_bottom;
+    } else {
+      // The window has probably gone away.
+      r->x = r->y = r->width = r->height = -1;
+    }
+    free (geometry);
+    free (translate);
+  }
+
+  g_free (geometry_cookies);
+  g_free (translate_cookies);
+  g_free (property_cookies);
+}
+#endif
+
+//------------------------------------------------------------------------------
+
+#ifndef HAVE_XCB
 static void
 ss_xinerama_get_frame_coordinates (SSXinerama *xinerama, SSWindow *window,
                                    int *out_x, int *out_y, int *out_width, int *out_height)
@@ -153,13 +241,38 @@ ss_xinerama_get_frame_coordinates (SSXinerama *xinerama, SSWindow *window,
   *out_width  = (unsigned int) width  + frame_left + frame_right;
   *out_height = (unsigned int) height + frame_top  + frame_bottom;
 }
+#endif
 
 //------------------------------------------------------------------------------
 
 void
-ss_xinerama_get_frame_extents (SSXinerama *xinerama, SSWindow *window,
-                               int *out_left, int *out_right,
-                               int *out_top, int *out_bottom)
+ss_xinerama_get_frame_rectangles (SSXinerama *xinerama, SSWindow **windows,
+                                  int num_windows, GdkRectangle *out_rectangles)
+{
+#ifndef HAVE_XCB
+  GdkRectangle *r;
+  int i;
+#endif
+
+  if (xinerama == NULL || num_windows <= 0) {
+    return;
+  }
+
+#ifdef HAVE_XCB
+  get_frame_rectangles_xcb (xinerama, windows, num_windows, out_rectangles);
+#else
+  for (i = 0; i < num_windows; i++) {
+    r = &out_rectangles[i];
+    ss_xinerama_get_frame_coordinates (xinerama, windows[i],
+      &r->x, &r->y, &r->width, &r->height);
+  }
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+static void
+get_frame_extents_uncached (SSXinerama *xinerama, SSWindow *window)
 {
   // XGetWindowProperty stuff
   Atom actual_type;
@@ -170,14 +283,6 @@ ss_xinerama_get_frame_extents (SSXinerama *xinerama, SSWindow *window,
   long *data_as_long;
   int status;
 
-  if (xinerama == NULL || window == NULL) {
-    *out_left   = 0;
-    *out_right  = 0;
-    *out_top    = 0;
-    *out_bottom = 0;
-    return;
-  }
-
   // Find the _NET_FRAME_EXTENTS, also known as the window border, including
   // the titlebar and resize grippies.
   status = XGetWindowProperty(
@@ -194,18 +299,47 @@ ss_xinerama_get_frame_extents (SSXinerama *xinerama, SSWindow *window,
     &bytes_remaining,
     &data);
 
-  *out_left = *out_right = *out_top = *out_bottom = 0;
+  window->frame_left = window->frame_right = 0;
+  window->frame_top = window->frame_bottom = 0;
   if (status == Success) {
     if ((nitems == 4) && (bytes_remaining == 0)) {
       // Hoop-jumping to avoid gcc's "dereferencing type-punned pointer" warning
       data_as_long = (long *) ((void *) data);
-      *out_left   = (int) *(data_as_long++);
-      *out_right  = (int) *(data_as_long++);
-      *out_top    = (int) *(data_as_long++);
-      *out_bottom = (int) *(data_as_long++);
+      window->frame_left   = (int) *(data_as_long++);
+      window->frame_right  = (int) *(data_as_long++);
+      window->frame_top    = (int) *(data_as_long++);
+      window->frame_bottom = (int) *(data_as_long++);
     }
     XFree (data);
   }
+
+  // An absent property is cached as zero extents, too.  If the window
+  // manager sets it later, the PropertyNotify invalidates the cache.
+  window->frame_extents_are_valid = TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_xinerama_get_frame_extents (SSXinerama *xinerama, SSWindow *window,
+                               int *out_left, int *out_right,
+                               int *out_top, int *out_bottom)
+{
+  if (xinerama == NULL || window == NULL) {
+    *out_left   = 0;
+    *out_right  = 0;
+    *out_top    = 0;
+    *out_bottom = 0;
+    return;
+  }
+
+  if (!window->frame_extents_are_valid) {
+    get_frame_extents_uncached (xinerama, window);
+  }
+  *out_left   = window->frame_left;
+  *out_right  = window->frame_right;
+  *out_top    = window->frame_top;
+  *out_bottom = window->frame_bottom;
 }
 
 //------------------------------------------------------------------------------
@@ -220,7 +354,7 @@ ss_xinerama_move_to_next_screen (SSXinerama *xinerama, SSWindow *window)
 
   // Co-ordinates of a window's frame (as set by the window manager, such as
   // metacity).
-  int fx, fy, fw, fh;
+  GdkRectangle f;
 
   if (xinerama->num_screens <= 1) {
     return;
@@ -237,11 +371,11 @@ ss_xinerama_move_to_next_screen (SSXinerama *xinerama, SSWindow *window)
   }
 
   // Get the window co-ordinates wrt the screen.
-  best_screen = get_best_screen (xinerama, window);
+  best_screen = window->xinerama_screen;
   xs = &xinerama->screens[best_screen];
-  ss_xinerama_get_frame_coordinates (xinerama, window, &fx, &fy, &fw, &fh);
-  dx = fx - xs->x;
-  dy = fy - xs->y;
+  ss_xinerama_get_frame_rectangles (xinerama, &window, 1, &f);
+  dx = f.x - xs->x;
+  dy = f.y - xs->y;
 
   // Now move to the next screen.
   best_screen = (best_screen + 1) % xinerama->num_screens;
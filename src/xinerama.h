@@ -4,6 +4,7 @@
 #ifndef SUPERSWITCHER_XINERAMA_H
 #define SUPERSWITCHER_XINERAMA_H
 
+#include <gdk/gdk.h>
 #include <X11/Xlib.h>
 
 #include "forward_declarations.h"
@@ -26,9 +27,17 @@ struct _SSXinerama {
 
 SSXinerama *   ss_xinerama_new   (Display *x_display, Window x_root_window);
 
-void   ss_xinerama_move_to_next_screen   (SSXinerama *xinerama, SSWindow *window);
-void   ss_xinerama_get_frame_extents     (SSXinerama *xinerama, SSWindow *window,
-                                          int *out_left, int *out_right,
-                                          int *out_top, int *out_bottom);
+int    ss_xinerama_get_screen_for_rectangle   (SSXinerama *xinerama,
+                                               int x, int y, int width, int height);
+void   ss_xinerama_move_to_next_screen        (SSXinerama *xinerama, SSWindow *window);
+void   ss_xinerama_get_frame_extents          (SSXinerama *xinerama, SSWindow *window,
+                                               int *out_left, int *out_right,
+                                               int *out_top, int *out_bottom);
+
+// Finds the frame rectangles of several (non-NULL) windows at once, in a
+// single round trip to the X server if we have XCB.
+void   ss_xinerama_get_frame_rectangles       (SSXinerama *xinerama,
+                                               SSWindow **windows, int num_windows,
+                                               GdkRectangle *out_rectangles);
 
 #endif
@@ -0,0 +1,263 @@
+#!/usr/bin/env python
+# A minimal EWMH window manager, just enough for libwnck (and hence
+# superswitcher) to see windows, workspaces, stacking order and the active
+# window, and for superswitcher's requests to change them to work.  It is a
+# stand-in for metacity when benchmarking under Xvfb, and not meant for real
+# use: there are no frames, no focus policy and no placement.
+#
+# Usage: bench_wm.py [num_workspaces]
+
+from __future__ import print_function
+import sys
+
+from Xlib import X, Xatom, Xutil, display, error
+from Xlib.protocol import event
+
+SCREEN_WIDTH_FALLBACK = 1280
+SCREEN_HEIGHT_FALLBACK = 1024
+
+
+class BenchWM(object):
+
+    def __init__(self, num_workspaces):
+        self.d = display.Display()
+        self.screen = self.d.screen()
+        self.root = self.screen.root
+        self.width = self.screen.width_in_pixels or SCREEN_WIDTH_FALLBACK
+        self.height = self.screen.height_in_pixels or SCREEN_HEIGHT_FALLBACK
+
+        self.num_workspaces = max(1, num_workspaces)
+        self.current_workspace = 0
+        self.clients = []        # In mapping order.
+        self.stacking = []       # Bottom-most first.
+        self.workspace_of = {}
+        self.unmaps_to_ignore = {}
+        self.active = X.NONE
+
+        self.atoms = {}
+        for name in ('_NET_SUPPORTED', '_NET_SUPPORTING_WM_CHECK',
+                     '_NET_WM_NAME', 'UTF8_STRING', '_NET_CLIENT_LIST',
+                     '_NET_CLIENT_LIST_STACKING', '_NET_ACTIVE_WINDOW',
+                     '_NET_NUMBER_OF_DESKTOPS', '_NET_CURRENT_DESKTOP',
+                     '_NET_DESKTOP_GEOMETRY', '_NET_DESKTOP_VIEWPORT',
+                     '_NET_WORKAREA', '_NET_WM_DESKTOP', '_NET_CLOSE_WINDOW',
+                     '_NET_FRAME_EXTENTS', 'WM_STATE', 'WM_PROTOCOLS',
+                     'WM_DELETE_WINDOW'):
+            self.atoms[name] = self.d.intern_atom(name)
+
+        caught = []
+        self.root.change_attributes(
+            event_mask=X.SubstructureRedirectMask | X.SubstructureNotifyMask,
+            onerror=lambda *args: caught.append(args))
+        self.d.sync()
+        if caught:
+            sys.exit('bench_wm.py: another window manager is already running')
+
+        self.check = self.root.create_window(-1, -1, 1, 1, 0,
+                                             self.screen.root_depth)
+        for w in (self.root, self.check):
+            w.change_property(self.atoms['_NET_SUPPORTING_WM_CHECK'],
+                              Xatom.WINDOW, 32, [self.check.id])
+        self.check.change_property(self.atoms['_NET_WM_NAME'],
+                                   self.atoms['UTF8_STRING'], 8, b'bench_wm')
+        self.set_root_cardinals('_NET_SUPPORTED',
+                                [self.atoms[k] for k in sorted(self.atoms)],
+                                Xatom.ATOM)
+        self.set_root_cardinals('_NET_DESKTOP_GEOMETRY',
+                                [self.width, self.height])
+        self.set_root_cardinals('_NET_DESKTOP_VIEWPORT', [0, 0])
+        self.update_workspaces()
+        self.update_client_lists()
+
+    # ---- Properties
+
+    def set_root_cardinals(self, name, values, type=Xatom.CARDINAL):
+        self.root.change_property(self.atoms[name], type, 32, values)
+
+    def update_workspaces(self):
+        self.set_root_cardinals('_NET_NUMBER_OF_DESKTOPS', [self.num_workspaces])
+        self.set_root_cardinals('_NET_CURRENT_DESKTOP', [self.current_workspace])
+        self.set_root_cardinals('_NET_WORKAREA',
+                                [0, 0, self.width, self.height] *
+                                self.num_workspaces)
+
+    def update_client_lists(self):
+        self.set_root_cardinals('_NET_CLIENT_LIST',
+                                [w.id for w in self.clients], Xatom.WINDOW)
+        self.set_root_cardinals('_NET_CLIENT_LIST_STACKING',
+                                [w.id for w in self.stacking], Xatom.WINDOW)
+        self.set_root_cardinals('_NET_ACTIVE_WINDOW', [self.active],
+                                Xatom.WINDOW)
+
+    def find_client(self, xid):
+        for w in self.clients:
+            if w.id == xid:
+                return w
+        return None
+
+    # ---- Client management
+
+    def show_or_hide(self, w):
+        if self.workspace_of[w.id] == self.current_workspace:
+            w.map()
+        else:
+            self.unmaps_to_ignore[w.id] = self.unmaps_to_ignore.get(w.id, 0) + 1
+            w.unmap()
+
+    def set_workspace(self, w, n):
+        n = max(0, min(n, self.num_workspaces - 1))
+        self.workspace_of[w.id] = n
+        w.change_property(self.atoms['_NET_WM_DESKTOP'], Xatom.CARDINAL, 32,
+                          [n])
+
+    def manage(self, w):
+        if self.find_client(w.id) is not None:
+            w.map()
+            return
+        prop = w.get_full_property(self.atoms['_NET_WM_DESKTOP'],
+                                   Xatom.CARDINAL)
+        if prop is not None and len(prop.value) > 0:
+            n = prop.value[0]
+        else:
+            n = self.current_workspace
+        self.clients.append(w)
+        self.stacking.append(w)
+        w.change_attributes(event_mask=X.PropertyChangeMask)
+        w.change_property(self.atoms['WM_STATE'], self.atoms['WM_STATE'], 32,
+                          [Xutil.NormalState, X.NONE])
+        w.change_property(self.atoms['_NET_FRAME_EXTENTS'], Xatom.CARDINAL,
+                          32, [0, 0, 0, 0])
+        self.set_workspace(w, n)
+        if n == self.current_workspace:
+            w.map()
+            self.activate(w)
+        self.update_client_lists()
+
+    def unmanage(self, xid):
+        w = self.find_client(xid)
+        if w is None:
+            return
+        self.clients.remove(w)
+        self.stacking = [s for s in self.stacking if s.id != xid]
+        del self.workspace_of[xid]
+        self.unmaps_to_ignore.pop(xid, None)
+        if self.active == xid:
+            self.active = X.NONE
+            for s in reversed(self.stacking):
+                if self.workspace_of[s.id] == self.current_workspace:
+                    self.activate(s)
+                    break
+        self.update_client_lists()
+
+    def raise_client(self, w):
+        self.stacking = [s for s in self.stacking if s.id != w.id] + [w]
+        w.configure(stack_mode=X.Above)
+
+    def activate(self, w):
+        n = self.workspace_of[w.id]
+        if n != self.current_workspace:
+            self.switch_workspace(n)
+        self.raise_client(w)
+        w.set_input_focus(X.RevertToPointerRoot, X.CurrentTime)
+        self.active = w.id
+        self.update_client_lists()
+
+    def switch_workspace(self, n):
+        n = max(0, min(n, self.num_workspaces - 1))
+        if n == self.current_workspace:
+            return
+        self.current_workspace = n
+        for w in self.clients:
+            self.show_or_hide(w)
+        if self.active != X.NONE and \
+           self.workspace_of.get(self.active) != n:
+            self.active = X.NONE
+        self.update_workspaces()
+        self.update_client_lists()
+
+    def set_num_workspaces(self, n):
+        self.num_workspaces = max(1, n)
+        for w in self.clients:
+            if self.workspace_of[w.id] >= self.num_workspaces:
+                self.set_workspace(w, self.num_workspaces - 1)
+                self.show_or_hide(w)
+        if self.current_workspace >= self.num_workspaces:
+            self.switch_workspace(self.num_workspaces - 1)
+        self.update_workspaces()
+
+    def close(self, w):
+        protocols = w.get_wm_protocols() or []
+        if self.atoms['WM_DELETE_WINDOW'] in protocols:
+            msg = event.ClientMessage(
+                window=w, client_type=self.atoms['WM_PROTOCOLS'],
+                data=(32, [self.atoms['WM_DELETE_WINDOW'], X.CurrentTime,
+                           0, 0, 0]))
+            w.send_event(msg)
+        else:
+            w.kill_client()
+
+    # ---- Event handling
+
+    def on_client_message(self, e):
+        w = self.find_client(e.window.id)
+        data = e.data[1]
+        if e.client_type == self.atoms['_NET_ACTIVE_WINDOW'] and w:
+            self.activate(w)
+        elif e.client_type == self.atoms['_NET_CURRENT_DESKTOP']:
+            self.switch_workspace(data[0])
+        elif e.client_type == self.atoms['_NET_NUMBER_OF_DESKTOPS']:
+            self.set_num_workspaces(data[0])
+        elif e.client_type == self.atoms['_NET_WM_DESKTOP'] and w:
+            self.set_workspace(w, data[0])
+            self.show_or_hide(w)
+            if self.active == w.id and \
+               self.workspace_of[w.id] != self.current_workspace:
+                self.active = X.NONE
+            self.update_client_lists()
+        elif e.client_type == self.atoms['_NET_CLOSE_WINDOW'] and w:
+            self.close(w)
+
+    def on_configure_request(self, e):
+        w = e.window
+        changes = {}
+        for field, mask in (('x', X.CWX), ('y', X.CWY),
+                            ('width', X.CWWidth), ('height', X.CWHeight),
+                            ('border_width', X.CWBorderWidth)):
+            if e.value_mask & mask:
+                changes[field] = getattr(e, field)
+        if changes:
+            w.configure(**changes)
+        if (e.value_mask & X.CWStackMode) and self.find_client(w.id):
+            self.raise_client(self.find_client(w.id))
+            self.update_client_lists()
+
+    def run(self):
+        while True:
+            e = self.d.next_event()
+            try:
+                if e.type == X.MapRequest:
+                    self.manage(e.window)
+                elif e.type == X.ConfigureRequest:
+                    self.on_configure_request(e)
+                elif e.type == X.ClientMessage:
+                    self.on_client_message(e)
+                elif e.type == X.UnmapNotify:
+                    n = self.unmaps_to_ignore.get(e.window.id, 0)
+                    if n > 0:
+                        self.unmaps_to_ignore[e.window.id] = n - 1
+                    else:
+                        self.unmanage(e.window.id)
+                elif e.type == X.DestroyNotify:
+                    self.unmanage(e.window.id)
+            except error.BadWindow:
+                # The client went away while we were dealing with it.
+                self.unmanage(e.window.id)
+            self.d.flush()
+
+
+if __name__ == '__main__':
+    try:
+        n = int(sys.argv[1])
+    except (IndexError, ValueError):
+        n = 4
+    BenchWM(n).run()
@@ -0,0 +1,341 @@
+#!/usr/bin/env python
+# Benchmarks superswitcher's popup latency under Xvfb.
+#
+# For each scenario (a number of windows spread over a number of workspaces),
+# this starts a private Xvfb, D-Bus session bus and bench_wm.py, opens the
+# windows, and then, for each action (showing and hiding the popup over D-Bus,
+# Super-Tab, Super-Up/Down and typing a search via XTest), runs a fresh
+# superswitcher --stats, drives it, and collects:
+#
+#   - the client-side round trip time of each D-Bus call (show/hide only),
+#   - the p50/p95/p99/max of each stage that superswitcher --stats reports,
+#   - superswitcher's resident set size once the action is done.
+#
+# A summary is printed, and the full results are written as JSON (to
+# bench-results.json by default), so that releases can be compared.
+#
+# With --window-storm, the windows are opened by tests/window_storm instead,
+# which also keeps changing them (at --storm-rate changes per second) while
+# superswitcher is being driven.
+#
+# It needs Xvfb, dbus-launch, python-xlib (with the XTEST extension) and
+# dbus-python.  Run it via "make bench", or directly, e.g.:
+#
+#   superswitcher_bench.py --superswitcher=src/superswitcher \
+#     --scenarios=10x4,100x8 --iterations=50 -- --persistent-popup
+#
+# Arguments after "--" are passed on to superswitcher.
+
+from __future__ import print_function
+import json, optparse, os, re, signal, subprocess, sys, time
+
+SCREEN_GEOMETRY = '1280x1024x24'
+ACTIONS = ['show-hide', 'super-tab', 'super-up-down', 'search']
+SEARCH_TEXT = 'window 1'
+
+
+def percentiles(samples):
+    # Uses the same nearest-rank method as superswitcher's stats.c.
+    s = sorted(samples)
+    n = len(s)
+    if n == 0:
+        return {'count': 0}
+    return {'count': n,
+            'p50': s[(n * 50) // 100],
+            'p95': s[(n * 95) // 100],
+            'p99': s[(n * 99) // 100],
+            'max': s[-1]}
+
+
+def find_free_display():
+    n = 50
+    while os.path.exists('/tmp/.X%d-lock' % n):
+        n += 1
+    return ':%d' % n
+
+
+def wait_for(predicate, timeout, what):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if predicate():
+            return
+        time.sleep(0.05)
+    sys.exit('superswitcher_bench.py: timed out waiting for %s' % what)
+
+
+def rss_in_kb(pid):
+    try:
+        for line in open('/proc/%d/status' % pid):
+            if line.startswith('VmRSS:'):
+                return int(line.split()[1])
+    except IOError:
+        pass
+    return None
+
+
+# Parses the table that superswitcher --stats prints at exit.
+STATS_ROW = re.compile(r'^\s+(\D+?)\s+(\d+)((?:\s+-?\d+){4})?\s*$')
+
+def parse_stats(text):
+    stages = {}
+    in_table = False
+    for line in text.splitlines():
+        if line.startswith('SuperSwitcher stats'):
+            in_table = True
+            stages = {}
+            continue
+        m = STATS_ROW.match(line)
+        if not in_table or not m or m.group(1) == 'stage':
+            continue
+        row = {'count': int(m.group(2))}
+        if m.group(3):
+            p50, p95, p99, mx = [int(x) for x in m.group(3).split()]
+            row.update({'p50': p50, 'p95': p95, 'p99': p99, 'max': mx})
+        stages[m.group(1)] = row
+    return stages
+
+
+class Session(object):
+    """An Xvfb, a D-Bus session bus and bench_wm.py, plus some windows."""
+
+    def __init__(self, num_windows, num_workspaces, options):
+        self.procs = []
+        self.env = dict(os.environ)
+        self.env['DISPLAY'] = find_free_display()
+        self.start(['Xvfb', self.env['DISPLAY'], '-screen', '0',
+                    SCREEN_GEOMETRY, '-nolisten', 'tcp'])
+
+        from Xlib import display, error
+        def can_connect():
+            try:
+                display.Display(self.env['DISPLAY']).close()
+                return True
+            except error.DisplayError:
+                return False
+        wait_for(can_connect, 10, 'Xvfb')
+
+        out = subprocess.check_output(['dbus-launch'], env=self.env)
+        for line in out.decode('ascii').splitlines():
+            key, _, value = line.partition('=')
+            if key == 'DBUS_SESSION_BUS_ADDRESS':
+                self.env[key] = value
+            elif key == 'DBUS_SESSION_BUS_PID':
+                self.dbus_pid = int(value)
+
+        here = os.path.dirname(os.path.abspath(__file__))
+        self.start([sys.executable, os.path.join(here, 'bench_wm.py'),
+                    str(num_workspaces)])
+        self.d = display.Display(self.env['DISPLAY'])
+        wm_check = self.d.intern_atom('_NET_SUPPORTING_WM_CHECK')
+        root = self.d.screen().root
+        wait_for(lambda: root.get_full_property(wm_check, 0) is not None,
+                 10, 'bench_wm.py')
+        if options.window_storm:
+            self.start([options.window_storm, '--windows=%d' % num_windows,
+                        '--workspaces=%d' % num_workspaces,
+                        '--rate=%d' % options.storm_rate, '--seed=1'])
+            client_list = self.d.intern_atom('_NET_CLIENT_LIST')
+            def all_windows_are_open():
+                prop = root.get_full_property(client_list, 0)
+                return prop is not None and len(prop.value) >= num_windows
+            wait_for(all_windows_are_open, 30, 'window_storm')
+        else:
+            self.open_windows(num_windows, num_workspaces)
+
+    def start(self, argv):
+        self.procs.append(subprocess.Popen(argv, env=self.env))
+
+    def open_windows(self, num_windows, num_workspaces):
+        from Xlib import Xatom
+        screen = self.d.screen()
+        net_wm_name = self.d.intern_atom('_NET_WM_NAME')
+        net_wm_desktop = self.d.intern_atom('_NET_WM_DESKTOP')
+        utf8_string = self.d.intern_atom('UTF8_STRING')
+        for i in range(num_windows):
+            w = screen.root.create_window(
+                20 * (i % 20), 20 * (i % 20), 400, 300, 0, screen.root_depth,
+                background_pixel=screen.white_pixel)
+            name = 'window %d' % i
+            w.set_wm_name(name)
+            w.change_property(net_wm_name, utf8_string, 8,
+                              name.encode('utf-8'))
+            w.set_wm_class('bench', 'Bench')
+            w.change_property(net_wm_desktop, Xatom.CARDINAL, 32,
+                              [i % num_workspaces])
+            w.map()
+        self.d.sync()
+
+    def close(self):
+        for p in reversed(self.procs):
+            p.terminate()
+            p.wait()
+        os.kill(self.dbus_pid, signal.SIGTERM)
+        self.d.close()
+
+
+class Keyboard(object):
+    """Fakes key presses via XTest."""
+
+    def __init__(self, d, delay):
+        from Xlib import XK
+        self.d = d
+        self.delay = delay
+        self.XK = XK
+
+    def keycode(self, name):
+        return self.d.keysym_to_keycode(self.XK.string_to_keysym(name))
+
+    def send(self, event_type, name):
+        from Xlib.ext import xtest
+        xtest.fake_input(self.d, event_type, self.keycode(name))
+        self.d.sync()
+
+    def press(self, name):
+        from Xlib import X
+        self.send(X.KeyPress, name)
+
+    def release(self, name):
+        from Xlib import X
+        self.send(X.KeyRelease, name)
+
+    def tap(self, name):
+        self.press(name)
+        self.release(name)
+        time.sleep(self.delay)
+
+    def char_to_key_name(self, c):
+        return 'space' if c == ' ' else c
+
+
+def run_action(session, options, action, superswitcher_args):
+    import dbus, dbus.bus
+    proc = subprocess.Popen([options.superswitcher, '--stats'] +
+                            superswitcher_args,
+                            env=session.env, stderr=subprocess.PIPE)
+
+    # D-Bus methods are only dispatched once superswitcher is in gtk_main,
+    # by which time its key grabs are in place.
+    bus = dbus.bus.BusConnection(session.env['DBUS_SESSION_BUS_ADDRESS'])
+    def is_ready():
+        try:
+            bus.get_object('superswitcher.SuperSwitcher',
+                           '/superswitcher/SuperSwitcher').HidePopup()
+            return True
+        except dbus.DBusException:
+            return False
+    wait_for(is_ready, 10, 'superswitcher')
+    ss = bus.get_object('superswitcher.SuperSwitcher',
+                        '/superswitcher/SuperSwitcher')
+
+    kb = Keyboard(session.d, options.key_delay / 1000.0)
+    show_ms, hide_ms = [], []
+    for i in range(options.iterations):
+        if action == 'show-hide':
+            t0 = time.time()
+            ss.ShowPopup()
+            t1 = time.time()
+            ss.HidePopup()
+            t2 = time.time()
+            show_ms.append(1000 * (t1 - t0))
+            hide_ms.append(1000 * (t2 - t1))
+            continue
+
+        kb.press('Super_L')
+        time.sleep(kb.delay)
+        if action == 'super-tab':
+            kb.tap('Tab')
+        elif action == 'super-up-down':
+            kb.tap('Down')
+            kb.tap('Up')
+        elif action == 'search':
+            for c in SEARCH_TEXT:
+                kb.tap(kb.char_to_key_name(c))
+            for c in SEARCH_TEXT:
+                kb.tap('BackSpace')
+        kb.release('Super_L')
+        time.sleep(kb.delay)
+
+    rss = rss_in_kb(proc.pid)
+    proc.send_signal(signal.SIGTERM)
+    _, err = proc.communicate()
+    bus.close()
+
+    result = {'action': action,
+              'rss_kb': rss,
+              'stages_us': parse_stats(err.decode('utf-8', 'replace'))}
+    if action == 'show-hide':
+        result['dbus_show_ms'] = percentiles(show_ms)
+        result['dbus_hide_ms'] = percentiles(hide_ms)
+    return result
+
+
+def print_result(scenario, result):
+    print('%s, %s: rss %s kB' % (scenario, result['action'], result['rss_kb']))
+    for key in ('dbus_show_ms', 'dbus_hide_ms'):
+        if key in result and result[key]['count'] > 0:
+            r = result[key]
+            print('  %-28s %6d %8.2f %8.2f %8.2f %8.2f' %
+                  (key, r['count'], r['p50'], r['p95'], r['p99'], r['max']))
+    for stage, r in sorted(result['stages_us'].items()):
+        if r['count'] > 0:
+            print('  %-28s %6d %8d %8d %8d %8d' %
+                  (stage, r['count'], r['p50'], r['p95'], r['p99'], r['max']))
+
+
+def main():
+    parser = optparse.OptionParser(
+        usage='%prog [options] [-- superswitcher options]')
+    parser.add_option('--superswitcher', default='src/superswitcher',
+                      help='the superswitcher binary [%default]')
+    parser.add_option('--scenarios', default='10x4,50x4,200x8',
+                      help='comma-separated WINDOWSxWORKSPACES [%default]')
+    parser.add_option('--actions', default=','.join(ACTIONS),
+                      help='comma-separated subset of %default')
+    parser.add_option('--iterations', type='int', default=20,
+                      help='times to repeat each action [%default]')
+    parser.add_option('--key-delay', type='int', default=20,
+                      help='milliseconds between faked key presses [%default]')
+    parser.add_option('--window-storm', default=None,
+                      help='open the windows with this tests/window_storm')
+    parser.add_option('--storm-rate', type='int', default=0,
+                      help='window_storm changes per second [%default]')
+    parser.add_option('--json', default='bench-results.json',
+                      help='where to write the results [%default]')
+    options, superswitcher_args = parser.parse_args()
+
+    actions = options.actions.split(',')
+    for action in actions:
+        if action not in ACTIONS:
+            parser.error('unknown action: %s' % action)
+
+    version = subprocess.check_output([options.superswitcher, '--version'])
+    results = {'superswitcher_version': version.decode('ascii').strip(),
+               'superswitcher_args': superswitcher_args,
+               'time': time.strftime('%Y-%m-%dT%H:%M:%S'),
+               'iterations': options.iterations,
+               'key_delay_ms': options.key_delay,
+               'storm_rate': options.window_storm and options.storm_rate,
+               'scenarios': []}
+
+    for scenario in options.scenarios.split(','):
+        num_windows, num_workspaces = [int(x) for x in scenario.split('x')]
+        session = Session(num_windows, num_workspaces, options)
+        try:
+            for action in actions:
+                result = run_action(session, options, action,
+                                    superswitcher_args)
+                result['num_windows'] = num_windows
+                result['num_workspaces'] = num_workspaces
+                results['scenarios'].append(result)
+                print_result(scenario, result)
+        finally:
+            session.close()
+
+    f = open(options.json, 'w')
+    json.dump(results, f, indent=2, sort_keys=True)
+    f.close()
+    print('Wrote %s' % options.json)
+
+
+if __name__ == '__main__':
+    main()
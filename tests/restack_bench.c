@@ -0,0 +1,206 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+// restack_bench times how superswitcher keeps its copy of the stacking order
+// up to date as the window manager restacks windows.  It runs the old way
+// (throw the copy away and re-append every window) against the in-place diff
+// in src/stacking.c (which it links against, so it exercises the very code
+// that superswitcher runs), on the same synthetic stack, and checks that both
+// give the same answer.  Each restack raises a window to the top, lowers one
+// to the bottom, moves one to a random position, or shuffles a handful of
+// windows amongst themselves.  It needs neither X nor libwnck.  See
+// restack_bench --help for its options.
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stacking.h"
+
+//------------------------------------------------------------------------------
+
+static int num_windows = 500;
+static int num_restacks = 10000;
+static int seed = 0;
+
+// Every SKIP_PAGER_EVERY'th window is skip-pager, and so not copied.
+#define SKIP_PAGER_EVERY 10
+
+//------------------------------------------------------------------------------
+
+// The stand-ins for a WnckWindow are the numbers 1 to num_windows.
+static gboolean
+is_skip_pager (gpointer window)
+{
+  return (GPOINTER_TO_INT (window) % SKIP_PAGER_EVERY) == 0;
+}
+
+//------------------------------------------------------------------------------
+
+// The most windows that one restack shuffles amongst themselves.
+#define MAX_SHUFFLED 8
+
+//------------------------------------------------------------------------------
+
+// Restacks the "window manager's" bottom-to-top stack in one of four ways.
+static GList *
+restack (GList *stacked)
+{
+  GList *links[MAX_SHUFFLED];
+  gpointer data[MAX_SHUFFLED];
+  gpointer tmp;
+  GList *link;
+  int i, j, k;
+
+  switch (g_random_int_range (0, 4)) {
+  case 0:
+    // Raise one window to the top.
+    link = g_list_nth (stacked, g_random_int_range (0, num_windows));
+    stacked = g_list_remove_link (stacked, link);
+    return g_list_concat (stacked, link);
+  case 1:
+    // Lower one window to the bottom.
+    link = g_list_nth (stacked, g_random_int_range (0, num_windows));
+    stacked = g_list_remove_link (stacked, link);
+    return g_list_concat (link, stacked);
+  case 2:
+    // Move one window to anywhere in the stack.
+    link = g_list_nth (stacked, g_random_int_range (0, num_windows));
+    stacked = g_list_remove_link (stacked, link);
+    stacked = g_list_insert_before (stacked,
+      g_list_nth (stacked, g_random_int_range (0, num_windows)), link->data);
+    g_list_free_1 (link);
+    return stacked;
+  default:
+    // Shuffle a few windows amongst the places that they were in.
+    // Each of the j windows still to be looked at is picked with probability
+    // (the number still wanted) / j, which picks exactly k of them.
+    k = g_random_int_range (2, MAX_SHUFFLED + 1);
+    k = MIN (k, num_windows);
+    i = 0;
+    for (link = stacked, j = num_windows; i < k; link = link->next, j--) {
+      if (g_random_int_range (0, j) < k - i) {
+        links[i] = link;
+        data[i] = link->data;
+        i++;
+      }
+    }
+    for (i = k - 1; i > 0; i--) {
+      j = g_random_int_range (0, i + 1);
+      tmp = data[i];
+      data[i] = data[j];
+      data[j] = tmp;
+    }
+    for (i = 0; i < k; i++) {
+      links[i]->data = data[i];
+    }
+    return stacked;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static GList *
+old_update (GList *copy, GList *stacked)
+{
+  GList *i;
+
+  g_list_free (copy);
+  copy = NULL;
+  for (i = stacked; i; i = i->next) {
+    if (is_skip_pager (i->data)) {
+      continue;
+    }
+    copy = g_list_append (copy, i->data);
+  }
+  return copy;
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+lists_are_equal (GList *a, GList *b)
+{
+  for (; a && b; a = a->next, b = b->next) {
+    if (a->data != b->data) {
+      return FALSE;
+    }
+  }
+  return (a == NULL) && (b == NULL);
+}
+
+//------------------------------------------------------------------------------
+
+int
+main (int argc, char **argv)
+{
+  static const GOptionEntry options[] = {
+    { "windows", 'n', 0, G_OPTION_ARG_INT, &num_windows,
+      "Stack this many windows (default 500)", "N" },
+    { "restacks", 'r', 0, G_OPTION_ARG_INT, &num_restacks,
+      "Time this many restacks (default 10000)", "N" },
+    { "seed", 's', 0, G_OPTION_ARG_INT, &seed,
+      "Seed the random number generator, for reproducible runs", "N" },
+    { NULL }
+  };
+
+  GOptionContext *context;
+  GError *error;
+  GList *stacked;
+  GList *old_copy;
+  SSStacking new_copy;
+  GTimer *timer;
+  double old_seconds, new_seconds;
+  int i;
+
+  context = g_option_context_new ("- time keeping a copy of the stacking order");
+  error = NULL;
+  g_option_context_add_main_entries (context, options, NULL);
+  g_option_context_parse (context, &argc, &argv, &error);
+  if (error) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return 1;
+  }
+  if (num_windows <= 1 || num_restacks <= 0) {
+    return 1;
+  }
+  g_random_set_seed (seed);
+
+  stacked = NULL;
+  for (i = num_windows; i > 0; i--) {
+    stacked = g_list_prepend (stacked, GINT_TO_POINTER (i));
+  }
+  old_copy = old_update (NULL, stacked);
+  ss_stacking_init (&new_copy);
+  ss_stacking_update (&new_copy, stacked, is_skip_pager);
+
+  timer = g_timer_new ();
+  old_seconds = 0;
+  new_seconds = 0;
+  for (i = 0; i < num_restacks; i++) {
+    stacked = restack (stacked);
+
+    g_timer_start (timer);
+    old_copy = old_update (old_copy, stacked);
+    old_seconds += g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    ss_stacking_update (&new_copy, stacked, is_skip_pager);
+    new_seconds += g_timer_elapsed (timer, NULL);
+
+    if (!lists_are_equal (old_copy, new_copy.head)) {
+      g_printerr ("restack_bench: the in-place diff went wrong at restack %d\n", i);
+      return 1;
+    }
+  }
+
+  printf ("%d windows, %d restacks\n", num_windows, num_restacks);
+  printf ("  rebuild:  %8.2f us per restack\n", 1e6 * old_seconds / num_restacks);
+  printf ("  in place: %8.2f us per restack\n", 1e6 * new_seconds / num_restacks);
+
+  g_timer_destroy (timer);
+  g_list_free (old_copy);
+  g_list_free (stacked);
+  return 0;
+}
@@ -1,5 +1,5 @@
 #!/usr/bin/env python
-import dbus, sys
+import dbus, sys, time
 ss = dbus.SessionBus().get_object('superswitcher.SuperSwitcher',
                                  '/superswitcher/SuperSwitcher')
 
@@ -8,6 +8,17 @@ try:
 except:
     n = 10
 
+show_time = 0.0
+hide_time = 0.0
 for i in range(n):
+    t0 = time.time()
     ss.ShowPopup()
+    t1 = time.time()
     ss.HidePopup()
+    t2 = time.time()
+    show_time += t1 - t0
+    hide_time += t2 - t1
+
+if n > 0:
+    print 'show: %.3f ms, hide: %.3f ms (mean of %d)' % \
+        (1000 * show_time / n, 1000 * hide_time / n, n)
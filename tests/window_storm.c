@@ -0,0 +1,346 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+// window_storm opens a number of X windows that look like a busy desktop's
+// (terminals, browser windows and so on), spread over the workspaces, and
+// then keeps changing their titles, geometry, urgency and stacking order at a
+// given rate.  It is for reproducing, and profiling, superswitcher under
+// heavy load.  It needs a window manager (e.g. tests/bench/bench_wm.py) to be
+// running.  See window_storm --help for its options.
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+//------------------------------------------------------------------------------
+
+#define ICON_SIZE 16
+
+typedef struct _Kind Kind;
+struct _Kind {
+  const char *   res_name;
+  const char *   res_class;
+  const char *   title_format;
+  gulong         icon_color;
+};
+
+// The title formats take a window number and a counter that goes up each
+// time the title changes.
+static const Kind kinds[] = {
+  { "gnome-terminal", "Gnome-terminal", "user@host: ~/src/project-%d/dir-%d",
+    0xff2e3436 },
+  { "Navigator", "Firefox", "Page %d.%d - Mozilla Firefox",
+    0xffe66000 },
+  { "evolution", "Evolution", "Inbox (%d/%d unread) - Evolution",
+    0xff3465a4 },
+  { "gedit", "Gedit", "notes-%d.txt (modified %d times) - gedit",
+    0xff73d216 },
+};
+#define NUM_KINDS (sizeof (kinds) / sizeof (kinds[0]))
+
+typedef struct _StormWindow StormWindow;
+struct _StormWindow {
+  Window         x_window;
+  const Kind *   kind;
+  int            title_counter;
+  gboolean       is_urgent;
+};
+
+typedef enum {
+  MUTATION_TITLE,
+  MUTATION_GEOMETRY,
+  MUTATION_URGENCY,
+  MUTATION_STACKING,
+  NUM_MUTATIONS
+} Mutation;
+
+static const char *mutation_names[NUM_MUTATIONS] = {
+  "title", "geometry", "urgency", "stacking"
+};
+
+//------------------------------------------------------------------------------
+
+static int num_windows = 100;
+static int num_workspaces = 4;
+static int rate = 100;
+static int duration = 0;
+static int seed = 0;
+static char *mutations_arg = NULL;
+
+static gboolean mutation_is_enabled[NUM_MUTATIONS];
+
+static Display *x_display = NULL;
+static Atom net_wm_name_atom;
+static Atom net_wm_icon_name_atom;
+static Atom net_wm_icon_atom;
+static Atom net_wm_desktop_atom;
+static Atom utf8_string_atom;
+
+//------------------------------------------------------------------------------
+
+static gint64
+get_monotonic_time_in_microseconds (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (((gint64) ts.tv_sec) * 1000000) + (ts.tv_nsec / 1000);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+set_title (StormWindow *w, int n)
+{
+  char *title;
+  title = g_strdup_printf (w->kind->title_format, n, w->title_counter);
+
+  XStoreName (x_display, w->x_window, title);
+  XChangeProperty (x_display, w->x_window, net_wm_name_atom, utf8_string_atom,
+                   8, PropModeReplace, (unsigned char *) title, strlen (title));
+  XChangeProperty (x_display, w->x_window, net_wm_icon_name_atom,
+                   utf8_string_atom, 8, PropModeReplace,
+                   (unsigned char *) title, strlen (title));
+  g_free (title);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+set_urgency (StormWindow *w)
+{
+  XWMHints *hints;
+  hints = XAllocWMHints ();
+  hints->flags = InputHint | StateHint;
+  hints->input = True;
+  hints->initial_state = NormalState;
+  if (w->is_urgent) {
+    hints->flags |= XUrgencyHint;
+  }
+  XSetWMHints (x_display, w->x_window, hints);
+  XFree (hints);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+set_icon (StormWindow *w)
+{
+  // _NET_WM_ICON is width, height and then ARGB pixels, as 32-bit CARDINALs,
+  // which Xlib wants as longs.
+  long data[2 + ICON_SIZE * ICON_SIZE];
+  int i;
+
+  data[0] = ICON_SIZE;
+  data[1] = ICON_SIZE;
+  for (i = 0; i < ICON_SIZE * ICON_SIZE; i++) {
+    data[2 + i] = w->kind->icon_color;
+  }
+  XChangeProperty (x_display, w->x_window, net_wm_icon_atom, XA_CARDINAL,
+                   32, PropModeReplace, (unsigned char *) data,
+                   2 + ICON_SIZE * ICON_SIZE);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+open_window (StormWindow *w, int n)
+{
+  XClassHint class_hint;
+  long workspace;
+  int screen;
+
+  screen = DefaultScreen (x_display);
+  w->kind = &kinds[g_random_int_range (0, NUM_KINDS)];
+  w->title_counter = 0;
+  w->is_urgent = FALSE;
+  w->x_window = XCreateSimpleWindow (x_display,
+                                     RootWindow (x_display, screen),
+                                     g_random_int_range (0, 600),
+                                     g_random_int_range (0, 400),
+                                     g_random_int_range (200, 800),
+                                     g_random_int_range (150, 600),
+                                     0,
+                                     BlackPixel (x_display, screen),
+                                     WhitePixel (x_display, screen));
+
+  class_hint.res_name = (char *) w->kind->res_name;
+  class_hint.res_class = (char *) w->kind->res_class;
+  XSetClassHint (x_display, w->x_window, &class_hint);
+
+  workspace = n % num_workspaces;
+  XChangeProperty (x_display, w->x_window, net_wm_desktop_atom, XA_CARDINAL,
+                   32, PropModeReplace, (unsigned char *) &workspace, 1);
+
+  set_title (w, n);
+  set_urgency (w);
+  set_icon (w);
+  XMapWindow (x_display, w->x_window);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+mutate (StormWindow *windows)
+{
+  StormWindow *w;
+  Mutation m;
+  int n;
+
+  do {
+    m = (Mutation) g_random_int_range (0, NUM_MUTATIONS);
+  } while (!mutation_is_enabled[m]);
+
+  n = g_random_int_range (0, num_windows);
+  w = &windows[n];
+  switch (m) {
+  case MUTATION_TITLE:
+    w->title_counter++;
+    set_title (w, n);
+    break;
+  case MUTATION_GEOMETRY:
+    XMoveResizeWindow (x_display, w->x_window,
+                       g_random_int_range (0, 600),
+                       g_random_int_range (0, 400),
+                       g_random_int_range (200, 800),
+                       g_random_int_range (150, 600));
+    break;
+  case MUTATION_URGENCY:
+    w->is_urgent = !w->is_urgent;
+    set_urgency (w);
+    break;
+  case MUTATION_STACKING:
+    XRaiseWindow (x_display, w->x_window);
+    break;
+  default:
+    break;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+parse_mutations (const char *s)
+{
+  gchar **names;
+  int i, j;
+  gboolean ok;
+
+  if (s == NULL) {
+    for (j = 0; j < NUM_MUTATIONS; j++) {
+      mutation_is_enabled[j] = TRUE;
+    }
+    return TRUE;
+  }
+
+  ok = TRUE;
+  names = g_strsplit (s, ",", -1);
+  for (i = 0; names[i] != NULL; i++) {
+    for (j = 0; j < NUM_MUTATIONS; j++) {
+      if (strcmp (names[i], mutation_names[j]) == 0) {
+        mutation_is_enabled[j] = TRUE;
+        break;
+      }
+    }
+    if (j == NUM_MUTATIONS) {
+      g_printerr ("window_storm: unknown mutation \"%s\"\n", names[i]);
+      ok = FALSE;
+    }
+  }
+  g_strfreev (names);
+
+  for (j = 0; j < NUM_MUTATIONS; j++) {
+    if (mutation_is_enabled[j]) {
+      return ok;
+    }
+  }
+  g_printerr ("window_storm: no mutations given\n");
+  return FALSE;
+}
+
+//------------------------------------------------------------------------------
+
+int
+main (int argc, char **argv)
+{
+  static const GOptionEntry options[] = {
+    { "windows", 'n', 0, G_OPTION_ARG_INT, &num_windows,
+      "Open this many windows (default 100)", "N" },
+    { "workspaces", 'w', 0, G_OPTION_ARG_INT, &num_workspaces,
+      "Spread the windows over this many workspaces (default 4)", "N" },
+    { "rate", 'r', 0, G_OPTION_ARG_INT, &rate,
+      "Make this many changes per second, or none if 0 (default 100)", "N" },
+    { "duration", 'd', 0, G_OPTION_ARG_INT, &duration,
+      "Exit after this many seconds, or never if 0 (default 0)", "SECONDS" },
+    { "seed", 's', 0, G_OPTION_ARG_INT, &seed,
+      "Seed the random number generator, for reproducible storms", "N" },
+    { "mutations", 'm', 0, G_OPTION_ARG_STRING, &mutations_arg,
+      "Comma-separated changes to make, out of title, geometry, urgency and stacking (default all)",
+      "LIST" },
+    { NULL }
+  };
+
+  GOptionContext *context;
+  GError *error;
+  StormWindow *windows;
+  gint64 start_time, now, num_mutations_done, num_mutations_due;
+  int i;
+
+  context = g_option_context_new ("- open and churn lots of X windows");
+  error = NULL;
+  g_option_context_add_main_entries (context, options, NULL);
+  g_option_context_parse (context, &argc, &argv, &error);
+  if (error) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return 1;
+  }
+  if (num_windows <= 0 || num_workspaces <= 0 || rate < 0 ||
+      !parse_mutations (mutations_arg)) {
+    return 1;
+  }
+  g_random_set_seed (seed);
+
+  x_display = XOpenDisplay (NULL);
+  if (x_display == NULL) {
+    g_printerr ("window_storm: cannot open display\n");
+    return 1;
+  }
+  net_wm_name_atom      = XInternAtom (x_display, "_NET_WM_NAME", False);
+  net_wm_icon_name_atom = XInternAtom (x_display, "_NET_WM_ICON_NAME", False);
+  net_wm_icon_atom      = XInternAtom (x_display, "_NET_WM_ICON", False);
+  net_wm_desktop_atom   = XInternAtom (x_display, "_NET_WM_DESKTOP", False);
+  utf8_string_atom      = XInternAtom (x_display, "UTF8_STRING", False);
+
+  windows = g_new (StormWindow, num_windows);
+  for (i = 0; i < num_windows; i++) {
+    open_window (&windows[i], i);
+  }
+  XSync (x_display, False);
+
+  // Rather than sleeping a fixed time between changes, we catch up with
+  // however many changes are due, so that high rates are met even though
+  // the sleeps are coarse.
+  start_time = get_monotonic_time_in_microseconds ();
+  num_mutations_done = 0;
+  while (TRUE) {
+    now = get_monotonic_time_in_microseconds ();
+    if (duration > 0 && now - start_time >= ((gint64) duration) * 1000000) {
+      break;
+    }
+    num_mutations_due = ((now - start_time) * rate) / 1000000;
+    for (; num_mutations_done < num_mutations_due; num_mutations_done++) {
+      mutate (windows);
+    }
+    XFlush (x_display);
+    g_usleep (10000);
+  }
+
+  XCloseDisplay (x_display);
+  g_free (windows);
+  return 0;
+}